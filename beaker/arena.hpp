@@ -0,0 +1,89 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_ARENA_HPP
+#define BEAKER_ARENA_HPP
+
+// The arena is a bump allocator. Objects are allocated
+// from large blocks, and all of the blocks are released
+// together when the arena is destroyed. The arena does
+// not run the destructors of the objects allocated in it;
+// that is left to the owner of the arena.
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+class Arena
+{
+public:
+  static constexpr std::size_t block_size = 1 << 16;
+
+  Arena() = default;
+  Arena(Arena const&) = delete;
+  Arena& operator=(Arena const&) = delete;
+  ~Arena();
+
+  void* allocate(std::size_t, std::size_t);
+
+  template<typename T, typename... Args>
+  T* make(Args&&...);
+
+private:
+  void* grow(std::size_t, std::size_t);
+
+  char*              first_ = nullptr;  // The next free byte
+  char*              last_ = nullptr;   // The end of the current block
+  std::vector<char*> blocks_;
+};
+
+
+inline
+Arena::~Arena()
+{
+  for (char* p : blocks_)
+    delete[] p;
+}
+
+
+// Allocate n bytes with the alignment a, which must be
+// a power of 2.
+inline void*
+Arena::allocate(std::size_t n, std::size_t a)
+{
+  std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(first_) + a - 1) & ~(a - 1);
+  if (!first_ || p + n > reinterpret_cast<std::uintptr_t>(last_))
+    return grow(n, a);
+  first_ = reinterpret_cast<char*>(p + n);
+  return reinterpret_cast<void*>(p);
+}
+
+
+// Allocate a new block that can hold n bytes with the
+// alignment a, and allocate from it. Requests larger
+// than a block get a block of their own.
+inline void*
+Arena::grow(std::size_t n, std::size_t a)
+{
+  std::size_t size = n + a > block_size ? n + a : block_size;
+  char* p = new char[size];
+  blocks_.push_back(p);
+  first_ = p;
+  last_ = p + size;
+  return allocate(n, a);
+}
+
+
+// Construct an object of type T in the arena.
+template<typename T, typename... Args>
+inline T*
+Arena::make(Args&&... args)
+{
+  return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+
+#endif
@@ -0,0 +1,159 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// The benchmark harness runs each workload through the
+// interpreter, and through the compiler followed by native
+// execution, and reports the median wall time of repeated
+// runs.
+//
+//    beaker-bench [options] file...
+//
+//    -n <runs>           The number of timed runs (default 5)
+//    -interpret <path>   The interpreter (default beaker-interpret)
+//    -compile <path>     The compiler (default beaker-compile)
+//    -cc <path>          The native compiler for LLVM IR (default clang)
+//    -no-native          Only run the interpreter
+//
+// The result of main is checked against the exit status of
+// the native program. Build products are written to the
+// current directory.
+
+#include "process.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+using String = std::string;
+
+
+struct Options
+{
+  int     runs = 5;
+  String  interpret = "beaker-interpret";
+  String  compile = "beaker-compile";
+  String  cc = "clang";
+  bool    native = true;
+  Command inputs;
+};
+
+
+// Returns the result printed by the interpreter in the
+// file out, or false if there is none.
+bool
+read_result(String const& out, long& n)
+{
+  std::ifstream f(out);
+  String line;
+  while (std::getline(f, line)) {
+    if (line.compare(0, 8, "result: ") == 0) {
+      n = std::strtol(line.c_str() + 8, nullptr, 10);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool
+parse_options(Options& opts, int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    String arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "-n" && has_value)
+      opts.runs = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "-interpret" && has_value)
+      opts.interpret = argv[++i];
+    else if (arg == "-compile" && has_value)
+      opts.compile = argv[++i];
+    else if (arg == "-cc" && has_value)
+      opts.cc = argv[++i];
+    else if (arg == "-no-native")
+      opts.native = false;
+    else if (arg[0] == '-') {
+      std::cerr << "error: invalid option '" << arg << "'\n";
+      return false;
+    }
+    else
+      opts.inputs.push_back(arg);
+  }
+  if (opts.inputs.empty()) {
+    std::cerr << "error: no input files\n";
+    return false;
+  }
+  return true;
+}
+
+
+void
+print_time(double t)
+{
+  if (t < 0)
+    std::cout << std::setw(12) << "failed";
+  else
+    std::cout << std::setw(12) << t;
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+
+  std::cout << std::fixed << std::setprecision(4);
+  std::cout << std::left << std::setw(16) << "workload" << std::right
+            << std::setw(12) << "interp (s)"
+            << std::setw(12) << "build (s)"
+            << std::setw(12) << "native (s)"
+            << std::setw(10) << "speedup" << '\n';
+
+  int errs = 0;
+  for (String const& in : opts.inputs) {
+    String name = stem(in);
+    std::cout << std::left << std::setw(16) << name << std::right;
+
+    // Interpret the program once to obtain its result,
+    // and then time it.
+    String out = name + ".out";
+    long result = 0;
+    Run r = run({opts.interpret, in}, out);
+    double interp = -1;
+    if (r.ok && r.status == 0 && read_result(out, result))
+      interp = median({opts.interpret, in}, opts.runs);
+    print_time(interp);
+
+    // Compile the program to LLVM IR and then to a native
+    // executable. The exit status of the program is the
+    // result of main, modulo 256.
+    double native = -1;
+    if (opts.native) {
+      String exe = "./" + name;
+      double build = build_native(opts.compile, opts.cc, in, name + ".ll", exe);
+      if (build >= 0) {
+        print_time(build);
+        native = median({exe}, opts.runs, result & 0xff);
+        if (native < 0 && interp >= 0)
+          std::cerr << "error: " << name << ": native result differs\n";
+      }
+      else
+        print_time(-1);
+      print_time(native);
+    }
+    else
+      std::cout << std::setw(12) << '-' << std::setw(12) << '-';
+
+    if (interp >= 0 && native > 0)
+      std::cout << std::setw(9) << std::setprecision(1)
+                << interp / native << 'x' << std::setprecision(4);
+    std::cout << '\n';
+
+    if (interp < 0 || (opts.native && native < 0))
+      ++errs;
+  }
+  return errs ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Compare the interpreter with native execution.
+//
+//    beaker-compare [options] file...
+//
+//    -n <runs>           The number of timed runs (default 3)
+//    -compile <path>     The compiler (default beaker-compile)
+//    -cc <path>          The native compiler for LLVM IR (default clang)
+//
+// Each program is translated in-process and run through
+// Evaluator::exec. It is then compiled with beaker-compile
+// and run natively. The tool checks that the result of main
+// agrees with the exit status of the native program, and
+// reports the slowdown of the interpreter.
+//
+// For each program, the report also gives the work done by
+// the interpreter: statements executed, calls, name lookups
+// and the environments probed per lookup, and store frames
+// pushed. The programs are then ranked by their share of the
+// total gap between interpreted and native time. The work of
+// the programs at the top of that ranking identifies the
+// interpreter improvements that would close the most gap.
+//
+// Programs without a main function are skipped.
+
+#include "process.hpp"
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "elaborator.hpp"
+#include "evaluator.hpp"
+#include "error.hpp"
+#include "timer.hpp"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+
+namespace
+{
+
+struct Options
+{
+  int     runs = 3;
+  String  compile = "beaker-compile";
+  String  cc = "clang";
+  Command inputs;
+};
+
+
+// The interpreter's work for one run of a program.
+struct Work
+{
+  std::size_t stmts;
+  std::size_t calls;
+  std::size_t lookups;
+  std::size_t probes;
+  std::size_t frames;
+};
+
+
+// The comparison of a program.
+struct Comparison
+{
+  String name;
+  long   result;
+  double interp;
+  double native;
+  bool   built;
+  bool   agree;
+  Work   work;
+};
+
+
+// Translate the program in the buffer buf. Returns its main
+// function, or nullptr if it has none. The buffer must outlive
+// the program, so that the locations of errors are resolved.
+Function_decl const*
+translate(Input_buffer& buf, Symbol_table& syms)
+{
+  Token_stream ts;
+  Literal_pool lits;
+  Lexer lex(syms, lits, buf);
+  if (!lex.lex(ts))
+    throw std::runtime_error("lexing failed");
+
+  Location_map locs;
+  Parser parse(syms, lits, ts, locs);
+  Decl* m = parse.module();
+  if (!parse)
+    throw std::runtime_error("parsing failed");
+
+  Elaborator elab(locs);
+  elab.elaborate(m);
+  return elab.main;
+}
+
+
+// Returns the integer result of main.
+long
+result(Value const& v)
+{
+  if (v.is_integer())
+    return v.get_integer();
+  throw std::runtime_error("main did not return an integer");
+}
+
+
+// Measure the interpreter's work in a single profiled run.
+Work
+profile(Function_decl const* main)
+{
+  std::size_t l0 = stack_lookups.value();
+  std::size_t p0 = stack_probes.value();
+  std::size_t f0 = pushed_frames.value();
+
+  Profiling_evaluator ev;
+  ev.exec(main);
+
+  std::size_t calls = 0;
+  for (auto const& x : ev.policy.fns)
+    calls += x.second.calls;
+  return {
+    ev.policy.stmts,
+    calls,
+    stack_lookups.value() - l0,
+    stack_probes.value() - p0,
+    pushed_frames.value() - f0
+  };
+}
+
+
+// Returns the median time of n runs of main.
+double
+interpret(Function_decl const* main, int n)
+{
+  std::vector<double> ts;
+  for (int i = 0; i < n; ++i) {
+    Evaluator ev;
+    Time_sample start = sample_time();
+    ev.exec(main);
+    ts.push_back((sample_time() - start).wall);
+  }
+  std::sort(ts.begin(), ts.end());
+  return ts[ts.size() / 2];
+}
+
+
+// Compare the program in the file in. Returns false if
+// the program was skipped.
+bool
+compare(Options const& opts, String const& in, Comparison& c)
+{
+  File src = in.c_str();
+  Input_buffer buf(src);
+  Symbol_table syms;
+  Function_decl const* main = translate(buf, syms);
+  if (!main)
+    return false;
+
+  c.name = stem(in);
+  {
+    Evaluator ev;
+    c.result = result(ev.exec(main));
+  }
+  c.interp = interpret(main, opts.runs);
+  c.work = profile(main);
+
+  // The native program reports the result of main,
+  // modulo 256, as its exit status.
+  String exe = "./" + c.name;
+  c.native = -1;
+  c.agree = false;
+  c.built = build_native(opts.compile, opts.cc, in, c.name + ".ll", exe) >= 0;
+  if (c.built) {
+    Run r = run({exe});
+    c.agree = r.ok && r.status == (c.result & 0xff);
+    if (c.agree)
+      c.native = median({exe}, opts.runs, r.status);
+  }
+  return true;
+}
+
+
+bool
+parse_options(Options& opts, int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    String arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "-n" && has_value)
+      opts.runs = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "-compile" && has_value)
+      opts.compile = argv[++i];
+    else if (arg == "-cc" && has_value)
+      opts.cc = argv[++i];
+    else if (arg[0] == '-') {
+      std::cerr << "error: invalid option '" << arg << "'\n";
+      return false;
+    }
+    else
+      opts.inputs.push_back(arg);
+  }
+  if (opts.inputs.empty()) {
+    std::cerr << "error: no input files\n";
+    return false;
+  }
+  return true;
+}
+
+
+void
+print_header()
+{
+  std::cout << std::left << std::setw(16) << "program" << std::right
+            << std::setw(12) << "result"
+            << std::setw(12) << "interp (s)"
+            << std::setw(12) << "native (s)"
+            << std::setw(10) << "slowdown"
+            << std::setw(12) << "stmts"
+            << std::setw(10) << "calls"
+            << std::setw(12) << "lookups"
+            << std::setw(8) << "probes"
+            << std::setw(10) << "frames" << '\n';
+}
+
+
+void
+print_row(Comparison const& c)
+{
+  Work const& w = c.work;
+  std::cout << std::left << std::setw(16) << c.name << std::right
+            << std::setw(12) << c.result
+            << std::setw(12) << std::setprecision(4) << c.interp;
+  if (c.native > 0)
+    std::cout << std::setw(12) << c.native
+              << std::setw(9) << std::setprecision(1) << c.interp / c.native << 'x';
+  else
+    std::cout << std::setw(12) << (c.built ? "differs" : "failed")
+              << std::setw(10) << '-';
+  std::cout << std::setw(12) << w.stmts
+            << std::setw(10) << w.calls
+            << std::setw(12) << w.lookups
+            << std::setw(8) << std::setprecision(2)
+            << (w.lookups ? double(w.probes) / w.lookups : 0.0)
+            << std::setw(10) << w.frames << '\n';
+}
+
+
+// Rank programs by their share of the total gap between
+// interpreted and native time.
+void
+print_gap(std::vector<Comparison> cs)
+{
+  auto gap = [](Comparison const& c) {
+    return c.native > 0 ? c.interp - c.native : 0.0;
+  };
+  double total = 0;
+  for (Comparison const& c : cs)
+    total += gap(c);
+  if (total <= 0)
+    return;
+
+  std::sort(cs.begin(), cs.end(), [&](Comparison const& a, Comparison const& b) {
+    return gap(a) > gap(b);
+  });
+  std::cout << "\ngap:\n";
+  for (Comparison const& c : cs) {
+    if (gap(c) <= 0)
+      continue;
+    Work const& w = c.work;
+    double ns = c.interp / std::max<std::size_t>(w.stmts, 1) * 1e9;
+    std::cout << "  " << std::left << std::setw(16) << c.name << std::right
+              << std::setw(8) << std::setprecision(1) << gap(c) / total * 100 << "%"
+              << std::setw(10) << ns << " ns/stmt"
+              << std::setw(8) << std::setprecision(2)
+              << double(w.lookups) / std::max<std::size_t>(w.stmts, 1) << " lookups/stmt"
+              << std::setw(8)
+              << double(w.frames) / std::max<std::size_t>(w.stmts, 1) << " frames/stmt\n";
+  }
+}
+
+} // namespace
+
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+
+  std::cout << std::fixed;
+  print_header();
+
+  int errs = 0;
+  std::vector<Comparison> cs;
+  for (String const& in : opts.inputs) {
+    Comparison c;
+    try {
+      if (!compare(opts, in, c))
+        continue;
+    }
+    catch (Translation_error& err) {
+      std::cerr << stem(in) << ": ";
+      diagnose(err);
+      ++errs;
+      continue;
+    }
+    catch (std::exception& err) {
+      std::cerr << stem(in) << ": error: " << err.what() << '\n';
+      ++errs;
+      continue;
+    }
+    print_row(c);
+    if (!c.agree)
+      ++errs;
+    cs.push_back(c);
+  }
+  print_gap(cs);
+  return errs ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Stress the concurrent symbol table.
+//
+//    beaker-intern [-j <threads>] [-n <names>] [-rounds <n>]
+//
+// In each round, every thread interns n identifiers (default
+// 100000) into a fresh table, in its own random order. The
+// names of each thread overlap those of the next thread by
+// half, so every name is raced by two threads. Before each
+// insertion, a thread looks up the name, and after it, looks
+// up a name of its neighbour, so lookups run concurrently
+// with insertions. After the round, the table is checked:
+//
+//    - every thread got the same symbol for each name,
+//    - a lookup never found a different symbol,
+//    - each symbol has its spelling, and is found by its index,
+//    - the table has one symbol per distinct name.
+//
+// The same work is then run against a Symbol_table guarded
+// by a single lock, for comparison. The report gives the
+// throughput of both tables. Returns non-zero if any check
+// fails.
+
+#include "concurrent_symbol.hpp"
+#include "token.hpp"
+#include "timer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+
+namespace
+{
+
+struct Options
+{
+  std::size_t threads = 4;
+  std::size_t names = 100000;
+  std::size_t rounds = 5;
+};
+
+
+// The names interned by the threads, and the range of
+// names of each thread.
+struct Workload
+{
+  Workload(Options const& opts)
+    : opts(opts), names((opts.threads + 1) * opts.names / 2)
+  {
+    for (std::size_t i = 0; i < names.size(); ++i)
+      names[i] = "x" + std::to_string(i);
+  }
+
+  std::size_t first(std::size_t t) const { return t * opts.names / 2; }
+
+  Options const&      opts;
+  std::vector<String> names;
+};
+
+
+// The results of one thread: the symbol interned for each
+// of its names, and the number of lookups that found the
+// wrong symbol.
+struct Result
+{
+  std::vector<Symbol const*> syms;
+  std::size_t                wrong = 0;
+};
+
+
+// Intern the names of thread t in tab, in a random order.
+// The table T is either the concurrent symbol table, or a
+// locked symbol table.
+template<typename T>
+void
+intern(T& tab, Workload const& w, std::size_t t, std::size_t round, Result& r)
+{
+  std::size_t n = w.opts.names;
+  std::size_t first = w.first(t);
+  std::size_t other = first + n;  // Names of other threads
+  std::vector<std::size_t> order(n);
+  for (std::size_t i = 0; i < n; ++i)
+    order[i] = i;
+  std::shuffle(order.begin(), order.end(), std::mt19937(round * w.opts.threads + t));
+
+  r.syms.assign(n, nullptr);
+  r.wrong = 0;
+  for (std::size_t i : order) {
+    String const& s = w.names[first + i];
+    Symbol const* a = tab.get(s);
+    Symbol const* b = tab.template put<Identifier_sym>(s, identifier_tok);
+    String const& o = w.names[(other + i) % w.names.size()];
+    Symbol const* c = tab.get(o);
+    if ((a && a != b) || b->spelling() != s)
+      ++r.wrong;
+    if (c && c->spelling() != o)
+      ++r.wrong;
+    r.syms[i] = b;
+  }
+}
+
+
+// A symbol table guarded by a single lock.
+struct Locked_symbol_table
+{
+  template<typename T, typename... Args>
+  Symbol const* put(String const& s, Args&&... args)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return syms.put<T>(s, std::forward<Args>(args)...);
+  }
+
+  Symbol const* get(String const& s)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return syms.get(s);
+  }
+
+  std::mutex   mutex;
+  Symbol_table syms;
+};
+
+
+// Run one round of the workload on a fresh table, returning
+// its wall time.
+template<typename T>
+double
+run(T& tab, Workload const& w, std::size_t round, std::vector<Result>& rs)
+{
+  std::vector<std::thread> pool;
+  Time_sample start = sample_time();
+  for (std::size_t t = 0; t < w.opts.threads; ++t)
+    pool.emplace_back([&, t]() { intern(tab, w, t, round, rs[t]); });
+  for (std::thread& t : pool)
+    t.join();
+  return (sample_time() - start).wall;
+}
+
+
+// Check the results of a round against the concurrent
+// table. Returns the number of errors.
+std::size_t
+check(Concurrent_symbol_table const& tab, Workload const& w, std::vector<Result> const& rs)
+{
+  std::size_t errs = 0;
+  std::vector<Symbol const*> syms(w.names.size(), nullptr);
+  for (std::size_t t = 0; t < rs.size(); ++t) {
+    errs += rs[t].wrong;
+    for (std::size_t i = 0; i < w.opts.names; ++i) {
+      Symbol const*& s = syms[w.first(t) + i];
+      if (s && s != rs[t].syms[i])
+        ++errs;
+      s = rs[t].syms[i];
+    }
+  }
+  for (std::size_t i = 0; i < syms.size(); ++i) {
+    Symbol const* s = syms[i];
+    if (s->spelling() != w.names[i] || tab.symbol(s->index()) != s || tab.get(w.names[i]) != s)
+      ++errs;
+  }
+  std::size_t reserved = reserved_symbols().size();
+  if (tab.size() != reserved + syms.size())
+    ++errs;
+  for (std::uint32_t i = 1; i < reserved; ++i) {
+    if (tab.symbol(i) != reserved_symbols()[i])
+      ++errs;
+  }
+  return errs;
+}
+
+
+bool
+parse_options(Options& opts, int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    char const* arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (!std::strcmp(arg, "-j") && has_value)
+      opts.threads = std::max(1l, std::atol(argv[++i]));
+    else if (!std::strcmp(arg, "-n") && has_value)
+      opts.names = std::max(2l, std::atol(argv[++i]));
+    else if (!std::strcmp(arg, "-rounds") && has_value)
+      opts.rounds = std::max(1l, std::atol(argv[++i]));
+    else {
+      std::cerr << "error: invalid argument '" << arg << "'\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+
+  Workload w(opts);
+  std::vector<Result> rs(opts.threads);
+  std::size_t errs = 0;
+  double conc = 0;
+  double locked = 0;
+  for (std::size_t i = 0; i < opts.rounds; ++i) {
+    {
+      Concurrent_symbol_table tab;
+      conc += run(tab, w, i, rs);
+      errs += check(tab, w, rs);
+    }
+    {
+      Locked_symbol_table tab;
+      locked += run(tab, w, i, rs);
+    }
+  }
+
+  // Each name is interned once and looked up twice.
+  double ops = 3.0 * opts.threads * opts.names * opts.rounds;
+  std::cout << std::fixed << std::setprecision(1)
+            << "threads:      " << opts.threads << '\n'
+            << "names:        " << w.names.size() << " ("
+                                << opts.names << " per thread)\n"
+            << "rounds:       " << opts.rounds << '\n'
+            << "concurrent:   " << ops / conc / 1e6 << " Mops/s\n"
+            << "locked:       " << ops / locked / 1e6 << " Mops/s\n";
+  if (errs) {
+    std::cerr << "error: " << errs << " inconsistent symbols\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,220 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Check that lexing in parallel is the same as lexing
+// serially.
+//
+//    beaker-lexeq [-seed <n>] [-rounds <n>] [-size <bytes>] [-chunk <bytes>]
+//
+// Each round generates a random input of up to the given
+// size (default 400000 bytes), lexes it serially, and then
+// lexes it again with 2, 3, 7, and 16 threads, each taking
+// chunks of at least the given size (default 4096 bytes),
+// so that there are many chunk boundaries. The inputs have:
+//
+//    - string literals that span lines and contain comment
+//      markers, escaped quotes, and character literals,
+//    - comments that contain quotes,
+//    - invalid characters, in every third round,
+//    - an unterminated string literal at the end, in every
+//      fifth round,
+//    - a size smaller than one chunk per thread, in every
+//      seventh round.
+//
+// The parallel lexer must produce the same tokens, with the
+// same symbol spellings, literal values, and offsets, the
+// same diagnostics, and the same result. Returns non-zero
+// if any lexing differs.
+
+#include "lexer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+
+namespace
+{
+
+struct Options
+{
+  unsigned    seed = 1;
+  std::size_t rounds = 30;
+  std::size_t size = 400000;
+  std::size_t chunk = 4096;
+};
+
+
+// The result of lexing an input.
+struct Result
+{
+  std::vector<Token> toks;
+  std::uint32_t      base;   // The offset of the input
+  bool               ok;
+  String             diags;  // The diagnostics printed
+};
+
+
+// Generate the input of round r.
+String
+generate(Options const& opts, std::size_t r, std::mt19937& g)
+{
+  static char const* pieces[] = { "\n", "//", "\\\"", "'", "x y", "$", "abc" };
+  std::size_t size = r % 7 == 6 ? opts.chunk + g() % opts.chunk : opts.size;
+  std::stringstream ss;
+  while (std::size_t(ss.tellp()) < size) {
+    switch (g() % 10) {
+      case 0:
+        ss << "var s" << g() % 1000 << " : int = \"";
+        for (std::size_t k = g() % 40; k != 0; --k)
+          ss << pieces[g() % 7];
+        ss << "\";\n";
+        break;
+      case 1:
+        if (r % 3 == 0)
+          ss << " $ ";
+        break;
+      case 2:
+        ss << "// comment \"with quote\n";
+        break;
+      default:
+        ss << "def f" << g() % 5000 << "(a : int) -> int { return a * "
+           << g() % 100000000 << " + 'c'; }\n";
+    }
+  }
+  if (r % 5 == 4)
+    ss << "\"unterminated\n";
+  return ss.str();
+}
+
+
+// Lex the text with n threads, capturing diagnostics.
+Result
+lex(String const& text, std::size_t n, std::size_t m, Symbol_table_ref syms, Literal_pool& lits)
+{
+  Result r;
+  Input_buffer in(text);
+  Token_stream ts;
+  Lexer lexer(syms, lits, in);
+  std::stringstream diags;
+  std::streambuf* cerr = std::cerr.rdbuf(diags.rdbuf());
+  try {
+    r.ok = lexer.lex(ts, n, m);
+  } catch (std::exception& err) {
+    diags << "exception: " << err.what() << '\n';
+    r.ok = false;
+  }
+  std::cerr.rdbuf(cerr);
+  r.base = in.location(in.begin()).offset();
+  r.diags = diags.str();
+  while (!ts.eof())
+    r.toks.push_back(ts.get());
+  return r;
+}
+
+
+// Returns true if the tokens a and b, of inputs at the
+// offsets x and y, are the same.
+bool
+same(Token a, Symbol_table& s1, Literal_pool const& l1, std::uint32_t x,
+     Token b, Concurrent_symbol_table& s2, Literal_pool const& l2, std::uint32_t y)
+{
+  if (a.kind() != b.kind() || a.location().offset() - x != b.location().offset() - y)
+    return false;
+  switch (a.kind()) {
+    case integer_tok:
+      return a.integer_value(l1) == b.integer_value(l2);
+    case character_tok:
+      return a.character_value() == b.character_value();
+    case string_tok:
+      return a.string_value(l1) == b.string_value(l2);
+    default:
+      Symbol const* p = a.symbol(s1);
+      Symbol const* q = b.symbol(s2);
+      return p == q || (p && q && p->spelling() == q->spelling());
+  }
+}
+
+
+// Compare the lexing of one input with n threads to the
+// serial lexing. Returns the number of differences.
+std::size_t
+check(Options const& opts, std::size_t round, String const& text, std::size_t n,
+      Result const& a, Symbol_table& s1, Literal_pool const& l1)
+{
+  Concurrent_symbol_table s2;
+  Literal_pool l2;
+  Result b = lex(text, n, opts.chunk, s2, l2);
+  std::size_t errs = 0;
+  if (a.toks.size() != b.toks.size())
+    ++errs;
+  for (std::size_t i = 0; i < std::min(a.toks.size(), b.toks.size()); ++i) {
+    if (!same(a.toks[i], s1, l1, a.base, b.toks[i], s2, l2, b.base))
+      ++errs;
+  }
+  if (a.ok != b.ok || a.diags != b.diags)
+    ++errs;
+  if (errs) {
+    std::cerr << "error: round " << round << " with " << n << " threads: "
+              << b.toks.size() << " tokens, expected " << a.toks.size() << '\n';
+  }
+  return errs;
+}
+
+
+bool
+parse_options(Options& opts, int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    char const* arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (!std::strcmp(arg, "-seed") && has_value)
+      opts.seed = std::atol(argv[++i]);
+    else if (!std::strcmp(arg, "-rounds") && has_value)
+      opts.rounds = std::max(1l, std::atol(argv[++i]));
+    else if (!std::strcmp(arg, "-size") && has_value)
+      opts.size = std::max(1l, std::atol(argv[++i]));
+    else if (!std::strcmp(arg, "-chunk") && has_value)
+      opts.chunk = std::max(1l, std::atol(argv[++i]));
+    else {
+      std::cerr << "error: invalid argument '" << arg << "'\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+
+  std::mt19937 g(opts.seed);
+  std::size_t errs = 0;
+  std::size_t toks = 0;
+  for (std::size_t r = 0; r < opts.rounds; ++r) {
+    String text = generate(opts, r, g);
+    Symbol_table s1;
+    Literal_pool l1;
+    Result a = lex(text, 1, opts.chunk, s1, l1);
+    for (std::size_t n : {2, 3, 7, 16})
+      errs += check(opts, r, text, n, a, s1, l1);
+    toks += a.toks.size();
+  }
+
+  std::cout << "rounds:       " << opts.rounds << '\n'
+            << "tokens:       " << toks << '\n';
+  if (errs) {
+    std::cerr << "error: " << errs << " differences\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,466 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Microbenchmarks for the data structures on the hot paths
+// of the front end and the interpreter.
+//
+//    beaker-micro [-t <seconds>] [filter...]
+//
+// Each benchmark runs batches of its body until the minimum
+// time (default 0.25s) has elapsed, and reports the time per
+// operation. Benchmarks that process input also report their
+// throughput. Only benchmarks whose names contain one of
+// the filters are run.
+
+#include "lexer.hpp"
+#include "type.hpp"
+#include "expr.hpp"
+#include "environment.hpp"
+#include "evaluator.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+// -------------------------------------------------------------------------- //
+// Benchmark framework
+
+// The state of a running benchmark. The body of each
+// benchmark is a loop of the form:
+//
+//    while (st.running()) { ... }
+//
+// Each iteration of the loop processes st.items operations
+// and st.bytes bytes of input. Work that should not be
+// measured is bracketed by st.pause() and st.resume().
+class Micro_state
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Micro_state(std::size_t n, int a)
+    : arg(a), iters_(n), left_(n)
+  { }
+
+  bool running();
+  void pause()  { elapsed_ += Clock::now() - start_; }
+  void resume() { start_ = Clock::now(); }
+
+  std::size_t iterations() const { return iters_; }
+  double      seconds() const    { return elapsed_.count(); }
+
+  int         arg;        // The benchmark argument
+  std::size_t items = 1;  // Operations per iteration
+  std::size_t bytes = 0;  // Bytes processed per iteration
+
+private:
+  std::size_t iters_;
+  std::size_t left_;
+  Clock::time_point start_;
+  std::chrono::duration<double> elapsed_ {0};
+};
+
+
+inline bool
+Micro_state::running()
+{
+  if (left_ == iters_)
+    resume();
+  if (left_-- == 0) {
+    pause();
+    return false;
+  }
+  return true;
+}
+
+
+// Prevent the compiler from discarding a computed value.
+template<typename T>
+inline void
+do_not_optimize(T const& x)
+{
+  asm volatile("" : : "g"(&x) : "memory");
+}
+
+
+using Micro_fn = void (*)(Micro_state&);
+
+
+struct Micro_benchmark
+{
+  char const*      name;
+  Micro_fn         fn;
+  std::vector<int> args;
+};
+
+
+// Run the benchmark with the given argument, increasing the
+// number of iterations until the run takes at least t seconds.
+void
+run(Micro_benchmark const& b, int arg, double t)
+{
+  std::size_t n = 1;
+  while (true) {
+    Micro_state st(n, arg);
+    b.fn(st);
+    double s = st.seconds();
+    if (s >= t || n >= (std::size_t(1) << 30)) {
+      std::stringstream name;
+      name << b.name;
+      if (!b.args.empty())
+        name << '/' << arg;
+      double ops = double(n) * st.items;
+      std::cout << std::left << std::setw(32) << name.str() << std::right
+                << std::setw(14) << std::setprecision(1) << s / ops * 1e9 << " ns/op";
+      if (st.bytes)
+        std::cout << std::setw(10) << std::setprecision(1)
+                  << n * st.bytes / s / (1 << 20) << " MB/s";
+      else
+        std::cout << std::setw(10) << std::setprecision(2)
+                  << ops / s / 1e6 << " Mop/s";
+      std::cout << '\n';
+      return;
+    }
+    n = s > 0 ? std::max(n * 2, std::size_t(n * t / s * 1.2)) : n * 10;
+  }
+}
+
+
+// -------------------------------------------------------------------------- //
+// Inputs
+
+// Returns n distinct identifier spellings.
+std::vector<String>
+identifiers(int n)
+{
+  std::vector<String> v;
+  for (int i = 0; i < n; ++i)
+    v.push_back("id" + std::to_string(i * 7919 % 1000003));
+  return v;
+}
+
+
+// Returns an identifier-heavy program of roughly n bytes.
+String
+program(std::size_t n)
+{
+  std::stringstream ss;
+  for (int i = 0; ss.tellp() < std::streamoff(n); ++i) {
+    ss << "def function" << i << "(alpha : int, beta : int) -> int\n"
+       << "{\n"
+       << "  var gamma : int = alpha * " << i << " + beta;\n"
+       << "  while (gamma < beta) {\n"
+       << "    gamma = gamma + alpha % 17; // accumulate\n"
+       << "  }\n"
+       << "  return gamma - function" << i / 2 << "(beta, alpha);\n"
+       << "}\n\n";
+  }
+  return ss.str();
+}
+
+
+Symbol_table&
+symbols()
+{
+  static Symbol_table syms;
+  return syms;
+}
+
+
+// Lex the buffer b into the token stream ts. This lexes
+// a view of b, so that lexing b again does not take new
+// offsets in the source map.
+void
+lex(Input_buffer const& b, Token_stream& ts)
+{
+  Input_buffer in(b, b.begin());
+  Literal_pool lits;
+  Lexer lex(symbols(), lits, in);
+  while (lex.scan(ts))
+    ;
+}
+
+
+// Returns the tokens of the text.
+std::vector<Token>
+lex(String const& text)
+{
+  Input_buffer in(text);
+  Token_stream ts;
+  lex(in, ts);
+  std::vector<Token> v;
+  while (!ts.eof())
+    v.push_back(ts.get());
+  return v;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Symbol table
+
+// Insert distinct identifiers into an empty table.
+void
+symbol_put(Micro_state& st)
+{
+  std::vector<String> ids = identifiers(st.arg);
+  st.items = ids.size();
+  while (st.running()) {
+    Symbol_table* syms = new Symbol_table;
+    for (String const& s : ids)
+      do_not_optimize(syms->put<Identifier_sym>(s, identifier_tok));
+    st.pause();
+    delete syms;
+    st.resume();
+  }
+}
+
+
+// Insert identifiers that are already in the table.
+void
+symbol_reput(Micro_state& st)
+{
+  std::vector<String> ids = identifiers(st.arg);
+  Symbol_table syms;
+  for (String const& s : ids)
+    syms.put<Identifier_sym>(s, identifier_tok);
+  st.items = ids.size();
+  while (st.running()) {
+    for (String const& s : ids)
+      do_not_optimize(syms.put<Identifier_sym>(s, identifier_tok));
+  }
+}
+
+
+void
+symbol_get(Micro_state& st)
+{
+  std::vector<String> ids = identifiers(st.arg);
+  Symbol_table syms;
+  for (String const& s : ids)
+    syms.put<Identifier_sym>(s, identifier_tok);
+  st.items = ids.size();
+  while (st.running()) {
+    for (String const& s : ids)
+      do_not_optimize(syms.get(s));
+  }
+}
+
+
+// Create an empty table.
+void
+symbol_init(Micro_state& st)
+{
+  while (st.running()) {
+    Symbol_table* syms = new Symbol_table;
+    do_not_optimize(syms);
+    st.pause();
+    delete syms;
+    st.resume();
+  }
+}
+
+
+// Look up punctuators and keywords.
+void
+symbol_reserved(Micro_state& st)
+{
+  std::vector<String> ids {"while", "(", "int", "return", "->", "==", "true", ";", "struct", "{"};
+  Symbol_table syms;
+  st.items = ids.size();
+  while (st.running()) {
+    for (String const& s : ids)
+      do_not_optimize(syms.get(s));
+  }
+}
+
+
+// -------------------------------------------------------------------------- //
+// Lexing
+
+// Lex a program of arg kilobytes.
+void
+lexer_scan(Micro_state& st)
+{
+  String text = program(st.arg * 1024);
+  Input_buffer in(text);
+  st.bytes = text.size();
+  while (st.running()) {
+    Token_stream* ts = new Token_stream;
+    lex(in, *ts);
+    st.pause();
+    delete ts;
+    st.resume();
+  }
+}
+
+
+// Peek arg tokens past each token in a stream.
+void
+token_peek(Micro_state& st)
+{
+  String text = program(64 * 1024);
+  Input_buffer in(text);
+  st.items = lex(text).size();
+  while (st.running()) {
+    st.pause();
+    Token_stream* ts = new Token_stream;
+    lex(in, *ts);
+    st.resume();
+    while (!ts->eof()) {
+      do_not_optimize(ts->peek(st.arg));
+      ts->get();
+    }
+    st.pause();
+    delete ts;
+    st.resume();
+  }
+}
+
+
+// -------------------------------------------------------------------------- //
+// Type interning
+
+// Returns arg distinct array types.
+std::vector<Type const*>
+array_types(int n)
+{
+  std::vector<Type const*> v;
+  Type const* z = get_integer_type();
+  for (int i = 0; i < n; ++i)
+    v.push_back(get_array_type(z, new Literal_expr(z, i + 1)));
+  return v;
+}
+
+
+// Intern arg distinct function types. After the first
+// pass, every request finds an existing type.
+void
+intern_function_type(Micro_state& st)
+{
+  std::vector<Type const*> ts = array_types(st.arg);
+  std::vector<Type_seq> parms;
+  for (std::size_t i = 0; i < ts.size(); ++i)
+    parms.push_back({get_integer_type(), ts[i], get_boolean_type()});
+  st.items = parms.size();
+  while (st.running()) {
+    for (Type_seq const& p : parms)
+      do_not_optimize(get_function_type(p, get_integer_type()));
+  }
+}
+
+
+void
+intern_array_type(Micro_state& st)
+{
+  Type const* z = get_integer_type();
+  std::vector<Expr*> ns;
+  for (int i = 0; i < st.arg; ++i)
+    ns.push_back(new Literal_expr(z, i + 1));
+  st.items = ns.size();
+  while (st.running()) {
+    for (Expr* n : ns)
+      do_not_optimize(get_array_type(z, n));
+  }
+}
+
+
+void
+intern_reference_type(Micro_state& st)
+{
+  std::vector<Type const*> ts = array_types(st.arg);
+  st.items = ts.size();
+  while (st.running()) {
+    for (Type const* t : ts)
+      do_not_optimize(get_reference_type(t));
+  }
+}
+
+
+// -------------------------------------------------------------------------- //
+// Environments
+
+// Look up a name bound in the outermost of arg nested
+// environments, each of which binds 8 names.
+void
+stack_lookup(Micro_state& st)
+{
+  using Env = Environment<Symbol const*, int>;
+  std::vector<String> ids = identifiers(st.arg * 8);
+  Symbol_table syms;
+  Stack<Env> stack;
+  for (int i = 0; i < st.arg; ++i) {
+    stack.push();
+    for (int j = 0; j < 8; ++j)
+      stack.top().bind(syms.put<Identifier_sym>(ids[i * 8 + j], identifier_tok), j);
+  }
+  Symbol const* outer = syms.get(ids[0]);
+  while (st.running())
+    do_not_optimize(stack.lookup(outer));
+}
+
+
+// -------------------------------------------------------------------------- //
+// Evaluation
+
+void
+eval_add(Micro_state& st)
+{
+  Type const* z = get_integer_type();
+  Literal_expr e1(z, 1);
+  Literal_expr e2(z, 2);
+  Add_expr add(&e1, &e2);
+  Evaluator ev;
+  Expr const* e = &add;
+  while (st.running())
+    do_not_optimize(ev.eval(e));
+}
+
+
+// -------------------------------------------------------------------------- //
+// Driver
+
+Micro_benchmark benchmarks[] = {
+  {"symbol_put", symbol_put, {1000, 100000}},
+  {"symbol_reput", symbol_reput, {1000, 100000}},
+  {"symbol_get", symbol_get, {1000, 100000}},
+  {"symbol_init", symbol_init, {}},
+  {"symbol_reserved", symbol_reserved, {}},
+  {"lexer_scan", lexer_scan, {64, 1024}},
+  {"token_peek", token_peek, {0, 1, 4, 16}},
+  {"intern_function_type", intern_function_type, {100, 10000}},
+  {"intern_array_type", intern_array_type, {100, 10000}},
+  {"intern_reference_type", intern_reference_type, {100, 10000}},
+  {"stack_lookup", stack_lookup, {1, 4, 16, 64}},
+  {"eval_add", eval_add, {}},
+};
+
+
+int
+main(int argc, char* argv[])
+{
+  double t = 0.25;
+  std::vector<String> filters;
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "-t") && i + 1 < argc)
+      t = std::atof(argv[++i]);
+    else
+      filters.push_back(argv[i]);
+  }
+
+  std::cout << std::fixed;
+  for (Micro_benchmark const& b : benchmarks) {
+    bool selected = filters.empty();
+    for (String const& f : filters)
+      selected |= String(b.name).find(f) != String::npos;
+    if (!selected)
+      continue;
+    if (b.args.empty())
+      run(b, 0, t);
+    for (int a : b.args)
+      run(b, a, t);
+  }
+}
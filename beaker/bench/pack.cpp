@@ -0,0 +1,190 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Run many instances of a program on a pool of threads.
+//
+//    beaker-pack [options] file
+//
+//    -n <instances>      The number of instances (default 1000)
+//    -j <threads>        The number of threads (default 4)
+//    -slice <fuel>       The fuel per time slice (default 10000)
+//    -fuel <n>           The fuel limit of each instance
+//    -depth <n>          The call depth limit (default 4096, at most
+//                        the calls that fit in a task's stack)
+//
+// The program is translated once, and each instance is
+// spawned as a task of the scheduler (see scheduler.hpp).
+// The report gives the throughput of the pool, and the
+// distribution of the latency of instances from spawn to
+// completion. Every instance must produce the same result.
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "elaborator.hpp"
+#include "scheduler.hpp"
+#include "error.hpp"
+#include "timer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+namespace
+{
+
+struct Options
+{
+  std::size_t instances = 1000;
+  std::size_t threads = 4;
+  std::size_t slice = Scheduler::default_slice;
+  Limits      lim = Scheduler::default_limits();
+  char const* input = nullptr;
+};
+
+
+// Translate the program in the file in. Returns its main
+// function, or nullptr if it has none.
+Function_decl const*
+translate(char const* in, Symbol_table& syms)
+{
+  File src = in;
+  Input_buffer buf(src);
+  Token_stream ts;
+  Literal_pool lits;
+  Lexer lex(syms, lits, buf);
+  if (!lex.lex(ts))
+    return nullptr;
+
+  Location_map locs;
+  Parser parse(syms, lits, ts, locs);
+  Decl* m = parse.module();
+  if (!parse)
+    return nullptr;
+
+  Elaborator elab(locs);
+  elab.elaborate(m);
+  return elab.main;
+}
+
+
+bool
+parse_options(Options& opts, int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    char const* arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (!std::strcmp(arg, "-n") && has_value)
+      opts.instances = std::max(1l, std::atol(argv[++i]));
+    else if (!std::strcmp(arg, "-j") && has_value)
+      opts.threads = std::max(1l, std::atol(argv[++i]));
+    else if (!std::strcmp(arg, "-slice") && has_value)
+      opts.slice = std::max(1l, std::atol(argv[++i]));
+    else if (!std::strcmp(arg, "-fuel") && has_value)
+      opts.lim.fuel = std::atol(argv[++i]);
+    else if (!std::strcmp(arg, "-depth") && has_value)
+      opts.lim.depth = std::atol(argv[++i]);
+    else if (arg[0] == '-' || opts.input) {
+      std::cerr << "error: invalid argument '" << arg << "'\n";
+      return false;
+    }
+    else
+      opts.input = arg;
+  }
+  if (!opts.input) {
+    std::cerr << "error: no input file\n";
+    return false;
+  }
+  return true;
+}
+
+
+String
+to_string(Value const& v)
+{
+  std::stringstream ss;
+  ss << v;
+  return ss.str();
+}
+
+} // namespace
+
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+
+  Symbol_table syms;
+  Function_decl const* fn;
+  try {
+    fn = translate(opts.input, syms);
+  } catch (Translation_error& err) {
+    diagnose(err);
+    return -1;
+  }
+  if (!fn) {
+    std::cerr << "error: no main\n";
+    return -1;
+  }
+
+  Scheduler sched(opts.slice);
+  for (std::size_t i = 0; i < opts.instances; ++i)
+    sched.spawn(fn, opts.lim);
+  Time_sample start = sample_time();
+  sched.run(opts.threads);
+  double wall = (sample_time() - start).wall;
+
+  // Check the results and collect latencies.
+  int errs = 0;
+  String expect;
+  std::size_t slices = 0;
+  std::vector<double> lats;
+  for (auto const& t : sched.tasks()) {
+    slices += t->slices();
+    lats.push_back(t->latency());
+    if (t->error()) {
+      try {
+        std::rethrow_exception(t->error());
+      } catch (Translation_error& err) {
+        if (!errs++)
+          diagnose(err);
+      } catch (std::exception& err) {
+        if (!errs++)
+          std::cerr << "error: " << err.what() << '\n';
+      }
+      continue;
+    }
+    String r = to_string(t->result());
+    if (expect.empty())
+      expect = r;
+    else if (r != expect && !errs++)
+      std::cerr << "error: results differ: " << r << " and " << expect << '\n';
+  }
+  std::sort(lats.begin(), lats.end());
+
+  auto pct = [&](double p) {
+    return lats[std::min(lats.size() - 1, std::size_t(p * lats.size()))];
+  };
+  std::cout << std::fixed << std::setprecision(3)
+            << "result:       " << expect << '\n'
+            << "instances:    " << opts.instances << " on "
+                                << opts.threads << " threads\n"
+            << "wall (s):     " << wall << '\n'
+            << "throughput:   " << std::setprecision(1)
+                                << opts.instances / wall << " /s\n"
+            << "slices:       " << slices << '\n'
+            << std::setprecision(4)
+            << "latency (s):  p50 " << pct(0.50)
+            << "  p90 " << pct(0.90)
+            << "  p99 " << pct(0.99)
+            << "  max " << lats.back() << '\n';
+  if (errs)
+    std::cerr << errs << " instances failed\n";
+  return errs ? 1 : 0;
+}
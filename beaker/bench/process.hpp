@@ -0,0 +1,114 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_BENCH_PROCESS_HPP
+#define BEAKER_BENCH_PROCESS_HPP
+
+// Facilities for running and timing child processes.
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+using Command = std::vector<std::string>;
+
+
+// The outcome of a process.
+struct Run
+{
+  bool   ok;      // True if the process exited normally
+  int    status;  // The exit status
+  double time;    // Wall time, in seconds
+};
+
+
+// Run the command, writing its standard output to the
+// file out or discarding it when out is empty.
+inline Run
+run(Command const& args, std::string const& out = "")
+{
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+
+  pid_t pid = fork();
+  if (pid < 0)
+    return {false, -1, 0};
+  if (pid == 0) {
+    char const* path = out.empty() ? "/dev/null" : out.c_str();
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      _exit(127);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    std::vector<char*> argv;
+    for (std::string const& a : args)
+      argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  std::chrono::duration<double> t = Clock::now() - start;
+  if (WIFEXITED(status))
+    return {true, WEXITSTATUS(status), t.count()};
+  else
+    return {false, -1, t.count()};
+}
+
+
+// Returns the median time of n runs of the command, or a
+// negative value if any run fails or exits with a status
+// other than expect.
+inline double
+median(Command const& args, int n, int expect = 0)
+{
+  std::vector<double> ts;
+  for (int i = 0; i < n; ++i) {
+    Run r = run(args);
+    if (!r.ok || r.status != expect)
+      return -1;
+    ts.push_back(r.time);
+  }
+  std::sort(ts.begin(), ts.end());
+  return ts[ts.size() / 2];
+}
+
+
+// Returns the base name of the path, without its
+// extension.
+inline std::string
+stem(std::string const& path)
+{
+  std::string s = path.substr(path.find_last_of('/') + 1);
+  return s.substr(0, s.find_last_of('.'));
+}
+
+
+// Compile the program in to a native executable exe, by
+// way of the LLVM IR file ll. Returns the combined time of
+// both steps, or a negative value on failure.
+inline double
+build_native(std::string const& compile, std::string const& cc,
+             std::string const& in, std::string const& ll,
+             std::string const& exe)
+{
+  Run r1 = run({compile, in}, ll);
+  if (!r1.ok || r1.status != 0)
+    return -1;
+  Run r2 = run({cc, "-O2", "-w", ll, "-o", exe});
+  if (!r2.ok || r2.status != 0)
+    return -1;
+  return r1.time + r2.time;
+}
+
+
+#endif
@@ -0,0 +1,437 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Check for performance regressions against a baseline.
+//
+//    beaker-regress [options] file...
+//
+//    -baseline <path>    The baseline file (required)
+//    -update             Write the results to the baseline
+//    -threshold <x>      Allowed relative regression (default 0.10)
+//    -n <runs>           The number of timed runs (default 5)
+//    -interpret <path>   The interpreter (default beaker-interpret)
+//    -compile <path>     The compiler (default beaker-compile)
+//    -no-compile         Only measure the interpreter
+//
+// Each file is a benchmark program. It is run through the
+// interpreter and compiled with beaker-compile. In addition,
+// synthetic programs of 10K and 100K lines are compiled to
+// measure compile throughput. For each run, the harness
+// records:
+//
+//    - the median wall time, in seconds,
+//    - the instructions retired, where the platform provides
+//      hardware counters (Linux perf events),
+//    - the peak RSS, in kilobytes, and
+//    - for compilation, the number of LLVM instructions
+//      emitted (see --stats).
+//
+// The baseline is a flat JSON object mapping metric names to
+// values. A metric that exceeds its baseline by more than the
+// threshold fails the run. Metrics that are missing from the
+// baseline, or that are unavailable on this platform, are
+// reported but never fail.
+//
+// The baseline is generated with -update on the reference
+// machine, where beaker-compile is built and hardware counters
+// are available, so that it has every metric. An update is
+// refused if any benchmark fails, since the baseline would be
+// missing the metrics of that benchmark. Where the compiler
+// cannot be built, -no-compile measures and updates only the
+// interpreter's metrics, keeping any others in the baseline.
+
+#include "process.hpp"
+#include "synth.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <sys/resource.h>
+
+#if defined(__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#endif
+
+
+namespace
+{
+
+using String = std::string;
+using Metrics = std::map<String, double>;
+
+
+struct Options
+{
+  String  baseline;
+  bool    update = false;
+  bool    compiled = true;
+  double  threshold = 0.10;
+  int     runs = 5;
+  String  interpret = "beaker-interpret";
+  String  compile = "beaker-compile";
+  Command inputs;
+};
+
+
+// The measurements of a single run of a process.
+struct Measurement
+{
+  bool   ok;
+  double time;          // Wall time, in seconds
+  double instructions;  // Instructions retired, or 0 if unavailable
+  double rss;           // Peak RSS, in kilobytes
+};
+
+
+#if defined(__linux__)
+// Open a counter of the instructions retired by the process
+// pid and its children. Counting begins when the process
+// calls exec. Returns -1 if counters are unavailable.
+int
+open_counter(pid_t pid)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+  attr.disabled = 1;
+  attr.enable_on_exec = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0);
+}
+#else
+int
+open_counter(pid_t)
+{
+  return -1;
+}
+#endif
+
+
+// Run the command once, writing its standard output and
+// error to the files out and err (or discarding them).
+//
+// The child waits on a pipe until the parent has attached
+// the instruction counter, so that only the instructions
+// of the command are counted.
+Measurement
+measure(Command const& args, String const& out = "", String const& err = "")
+{
+  int sync[2];
+  if (pipe(sync))
+    return {false, 0, 0, 0};
+
+  using Clock = std::chrono::steady_clock;
+  pid_t pid = fork();
+  if (pid < 0)
+    return {false, 0, 0, 0};
+  if (pid == 0) {
+    close(sync[1]);
+    char c;
+    if (read(sync[0], &c, 1) != 1)
+      _exit(127);
+    close(sync[0]);
+
+    auto redirect = [](String const& path, int fd) {
+      int f = open(path.empty() ? "/dev/null" : path.c_str(),
+                   O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (f < 0)
+        _exit(127);
+      dup2(f, fd);
+      close(f);
+    };
+    redirect(out, STDOUT_FILENO);
+    redirect(err, STDERR_FILENO);
+
+    std::vector<char*> argv;
+    for (String const& a : args)
+      argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+
+  close(sync[0]);
+  int counter = open_counter(pid);
+  auto start = Clock::now();
+  ssize_t w = write(sync[1], "x", 1);
+  close(sync[1]);
+
+  int status;
+  rusage ru;
+  wait4(pid, &status, 0, &ru);
+  std::chrono::duration<double> t = Clock::now() - start;
+
+  long long n = 0;
+  if (counter >= 0) {
+    if (read(counter, &n, sizeof(n)) != sizeof(n))
+      n = 0;
+    close(counter);
+  }
+
+  bool ok = w == 1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  return {ok, t.count(), double(n), double(ru.ru_maxrss)};
+}
+
+
+// Run the command n times and record the median time, and
+// the minimum instruction count and peak RSS, under the
+// given prefix. Returns false if any run fails.
+bool
+record(Metrics& m, String const& prefix, Command const& args, int n)
+{
+  std::vector<double> ts;
+  double insns = 0;
+  double rss = 0;
+  for (int i = 0; i < n; ++i) {
+    Measurement r = measure(args);
+    if (!r.ok)
+      return false;
+    ts.push_back(r.time);
+    insns = i ? std::min(insns, r.instructions) : r.instructions;
+    rss = i ? std::min(rss, r.rss) : r.rss;
+  }
+  std::sort(ts.begin(), ts.end());
+  m[prefix + ".time"] = ts[ts.size() / 2];
+  if (insns > 0)
+    m[prefix + ".instructions"] = insns;
+  m[prefix + ".rss"] = rss;
+  return true;
+}
+
+
+// Compile the program and record the number of LLVM
+// instructions emitted.
+bool
+record_llvm(Metrics& m, String const& name, Options const& opts, String const& in)
+{
+  String err = name + ".stats";
+  Measurement r = measure({opts.compile, "--stats=json", in}, "", err);
+  if (!r.ok)
+    return false;
+
+  std::ifstream f(err);
+  String line;
+  while (std::getline(f, line)) {
+    std::size_t k = line.find("\"llvm.instructions\":");
+    if (k != String::npos) {
+      m[name + ".llvm.instructions"] = std::atof(line.c_str() + k + 20);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Baselines
+
+// Read a flat JSON object of numbers.
+bool
+read_metrics(String const& path, Metrics& m)
+{
+  std::ifstream f(path);
+  if (!f)
+    return false;
+  std::stringstream ss;
+  ss << f.rdbuf();
+  String s = ss.str();
+
+  std::size_t i = 0;
+  while ((i = s.find('"', i)) != String::npos) {
+    std::size_t j = s.find('"', i + 1);
+    std::size_t k = s.find(':', j);
+    if (j == String::npos || k == String::npos)
+      return false;
+    m[s.substr(i + 1, j - i - 1)] = std::atof(s.c_str() + k + 1);
+    i = s.find_first_of(",}", k);
+  }
+  return true;
+}
+
+
+bool
+write_metrics(String const& path, Metrics const& m)
+{
+  std::ofstream f(path);
+  f << std::setprecision(6) << "{\n";
+  std::size_t n = 0;
+  for (auto const& x : m) {
+    f << "  \"" << x.first << "\": " << x.second;
+    if (++n != m.size())
+      f << ',';
+    f << '\n';
+  }
+  f << "}\n";
+  return bool(f);
+}
+
+
+// Returns true if the difference between the baseline b
+// and current value c of the metric is below the resolution
+// of the measurement. Wall times differing by less than a
+// few milliseconds are noise.
+bool
+is_noise(String const& name, double b, double c)
+{
+  String suffix = ".time";
+  bool time = name.size() > suffix.size() &&
+              name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+  return time && std::abs(c - b) < 0.005;
+}
+
+
+// Compare the results with the baseline. Returns the
+// number of regressions.
+int
+check(Metrics const& base, Metrics const& cur, double threshold)
+{
+  int errs = 0;
+  std::cout << std::left << std::setw(40) << "metric" << std::right
+            << std::setw(16) << "baseline"
+            << std::setw(16) << "current"
+            << std::setw(10) << "change" << '\n';
+  for (auto const& x : cur) {
+    std::cout << std::left << std::setw(40) << x.first << std::right;
+    auto iter = base.find(x.first);
+    if (iter == base.end()) {
+      std::cout << std::setw(16) << '-'
+                << std::setw(16) << x.second << "  new\n";
+      continue;
+    }
+    double b = iter->second;
+    double change = b ? (x.second - b) / b : 0;
+    std::cout << std::setw(16) << b
+              << std::setw(16) << x.second
+              << std::setw(9) << std::setprecision(1) << change * 100 << '%'
+              << std::setprecision(4);
+    if (change > threshold && !is_noise(x.first, b, x.second)) {
+      std::cout << "  REGRESSION";
+      ++errs;
+    }
+    std::cout << '\n';
+  }
+  return errs;
+}
+
+
+bool
+parse_options(Options& opts, int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    String arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "-baseline" && has_value)
+      opts.baseline = argv[++i];
+    else if (arg == "-update")
+      opts.update = true;
+    else if (arg == "-threshold" && has_value)
+      opts.threshold = std::atof(argv[++i]);
+    else if (arg == "-n" && has_value)
+      opts.runs = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "-interpret" && has_value)
+      opts.interpret = argv[++i];
+    else if (arg == "-compile" && has_value)
+      opts.compile = argv[++i];
+    else if (arg == "-no-compile")
+      opts.compiled = false;
+    else if (arg[0] == '-') {
+      std::cerr << "error: invalid option '" << arg << "'\n";
+      return false;
+    }
+    else
+      opts.inputs.push_back(arg);
+  }
+  if (opts.baseline.empty()) {
+    std::cerr << "error: no baseline\n";
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char* argv[])
+{
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+
+  Metrics cur;
+  int errs = 0;
+
+  // Benchmark programs.
+  for (String const& in : opts.inputs) {
+    String name = stem(in);
+    if (!record(cur, name + ".interp", {opts.interpret, in}, opts.runs)) {
+      std::cerr << "error: " << name << ": interpretation failed\n";
+      ++errs;
+    }
+    if (opts.compiled && !record_llvm(cur, name, opts, in)) {
+      std::cerr << "error: " << name << ": compilation failed\n";
+      ++errs;
+    }
+  }
+
+  // Compile throughput.
+  if (opts.compiled) {
+    for (std::size_t n : {10000, 100000}) {
+      String name = "synth-" + std::to_string(n / 1000) + "k";
+      String in = name + ".bkr";
+      Synth_options so;
+      so.lines = n;
+      std::ofstream f(in);
+      synthesize(f, so);
+      f.close();
+      if (!record(cur, name + ".compile", {opts.compile, in}, opts.runs) ||
+          !record_llvm(cur, name, opts, in)) {
+        std::cerr << "error: " << name << ": compilation failed\n";
+        ++errs;
+      }
+    }
+  }
+
+  if (opts.update) {
+    if (errs) {
+      std::cerr << "error: not updating '" << opts.baseline << "': "
+                << errs << " runs failed\n";
+      return 1;
+    }
+    // Keep the compiler's metrics of the old baseline if
+    // the compiler was not measured.
+    Metrics base;
+    if (!opts.compiled && read_metrics(opts.baseline, base)) {
+      for (auto const& x : cur)
+        base[x.first] = x.second;
+      cur.swap(base);
+    }
+    if (!write_metrics(opts.baseline, cur)) {
+      std::cerr << "error: cannot write '" << opts.baseline << "'\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  Metrics base;
+  if (!read_metrics(opts.baseline, base)) {
+    std::cerr << "error: cannot read '" << opts.baseline << "'"
+              << " (generate it with -update)\n";
+    return 1;
+  }
+  std::cout << std::fixed << std::setprecision(4);
+  errs += check(base, cur, opts.threshold);
+  return errs ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Measure how translation scales with the size of its input.
+//
+//    beaker-scale [-max <lines>] [-no-codegen]
+//
+// Synthetic programs growing by a factor of 4 from 1K lines
+// to the maximum (default 1M) are lexed, parsed, elaborated,
+// and lowered to LLVM. Each size is translated in a separate
+// process so that its peak RSS is independent of the others.
+// For each size, the report gives the time of each phase, the
+// bytes allocated by the front end, and the peak RSS.
+
+#include "synth.hpp"
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "elaborator.hpp"
+#include "generator.hpp"
+#include "error.hpp"
+#include "phase.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+// Run a phase of translation, returning its wall time.
+template<typename F>
+double
+phase(Time_region r, F fn)
+{
+  Time_sample start = sample_time();
+  Phase_sentinel p(r);
+  fn();
+  p.stop();
+  return (sample_time() - start).wall;
+}
+
+
+// Translate a synthetic program of n lines and print a row
+// of the report. Returns false if translation fails.
+bool
+translate(std::size_t n, bool codegen)
+{
+  Synth_options opts;
+  opts.lines = n;
+  std::stringstream ss;
+  std::size_t lines = synthesize(ss, opts);
+  String text = ss.str();
+
+  memory_report().enable();
+  Symbol_table syms;
+
+  Input_buffer in(text);
+  Token_stream ts;
+  Literal_pool lits;
+  Location_map locs;
+  Decl* m = nullptr;
+  bool ok = true;
+  double t[4] = { };
+  try {
+    t[0] = phase(lexing_time, [&]() {
+      Lexer lex(syms, lits, in);
+      ok = lex.lex(ts);
+    });
+    t[1] = phase(parsing_time, [&]() {
+      Parser parse(syms, lits, ts, locs);
+      m = parse.module();
+      ok &= bool(parse);
+    });
+    if (!ok)
+      return false;
+    t[2] = phase(elaboration_time, [&]() {
+      Elaborator elab(locs);
+      elab.elaborate(m);
+    });
+    if (codegen) {
+      t[3] = phase(generation_time, [&]() {
+        Generator gen;
+        gen(m);
+      });
+    }
+  } catch (Translation_error& err) {
+    diagnose(err);
+    return false;
+  }
+
+  std::size_t bytes = 0;
+  for (int p = lexing_time; p <= generation_time; ++p)
+    bytes += memory_report().total(p).bytes;
+  double total = t[0] + t[1] + t[2] + t[3];
+
+  std::cout << std::setw(9) << lines
+            << std::setw(12) << text.size();
+  for (double x : t)
+    std::cout << std::setw(10) << std::setprecision(3) << x;
+  std::cout << std::setw(10) << std::setprecision(3) << total
+            << std::setw(10) << std::setprecision(2) << total / lines * 1e6
+            << std::setw(12) << std::setprecision(1) << bytes / double(1 << 20)
+            << std::setw(12) << std::setprecision(1) << peak_rss() / 1024.0
+            << std::endl;
+  return true;
+}
+
+} // namespace
+
+
+int
+main(int argc, char* argv[])
+{
+  std::size_t max = 1 << 20;
+  bool codegen = true;
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "-max") && i + 1 < argc)
+      max = std::atol(argv[++i]);
+    else if (!std::strcmp(argv[i], "-no-codegen"))
+      codegen = false;
+    else {
+      std::cerr << "error: invalid option '" << argv[i] << "'\n";
+      return -1;
+    }
+  }
+
+  std::cout << std::fixed;
+  std::cout << std::setw(9) << "lines"
+            << std::setw(12) << "bytes"
+            << std::setw(10) << "lex (s)"
+            << std::setw(10) << "parse (s)"
+            << std::setw(10) << "elab (s)"
+            << std::setw(10) << "gen (s)"
+            << std::setw(10) << "total (s)"
+            << std::setw(10) << "us/line"
+            << std::setw(12) << "alloc (MB)"
+            << std::setw(12) << "RSS (MB)" << '\n';
+
+  for (std::size_t n = 1024; n <= max; n *= 4) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0)
+      _exit(translate(n, codegen) ? 0 : 1);
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || status != 0) {
+      std::cerr << "error: translation of " << n << " lines failed\n";
+      return 1;
+    }
+  }
+}
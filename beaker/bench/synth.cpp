@@ -0,0 +1,135 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "synth.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+
+namespace
+{
+
+using String = std::string;
+
+
+// Write a record whose fields alternate between scalar
+// types. The second field of each record (after the
+// first) nests the previous record.
+void
+record(std::ostream& os, int n, Synth_options const& opts)
+{
+  static char const* types[] = {"int", "bool", "char"};
+  os << "struct R" << n << " {\n";
+  for (int i = 0; i < opts.fields; ++i) {
+    os << "  f" << i << " : ";
+    if (i == 1 && n > 0)
+      os << 'R' << n - 1;
+    else
+      os << types[i % 3];
+    os << ";\n";
+  }
+  os << "}\n\n";
+  os << "var r" << n << " : R" << n << ";\n\n";
+}
+
+
+// Write a global array and a function that accesses it.
+void
+array(std::ostream& os, int n, Synth_options const& opts)
+{
+  os << "var a" << n << " : int[" << opts.extent + n << "];\n\n";
+  os << "def get" << n << "(i : int) -> int\n"
+     << "{\n"
+     << "  a" << n << "[i] = i * 2;\n"
+     << "  return a" << n << "[i % " << opts.extent << "];\n"
+     << "}\n\n";
+}
+
+
+// Write a function whose body is a sequence of nested
+// if and while statements, each introducing a variable.
+void
+nest(std::ostream& os, int n, Synth_options const& opts)
+{
+  os << "def nest" << n << "(x : int) -> int\n"
+     << "{\n"
+     << "  var y0 : int = x;\n";
+  String indent = "  ";
+  for (int i = 1; i <= opts.depth; ++i) {
+    if (i % 2)
+      os << indent << "if (y" << i - 1 << " > " << i << ") {\n";
+    else
+      os << indent << "while (y" << i - 1 << " > " << i << ") {\n";
+    indent += "  ";
+    os << indent << "var y" << i << " : int = y" << i - 1 << " - 1;\n";
+  }
+  for (int i = opts.depth; i >= 1; --i) {
+    os << indent << "y" << i - 1 << " = y" << i - 1 << " - 1;\n";
+    indent.resize(indent.size() - 2);
+    os << indent << "}\n";
+  }
+  os << "  return y0;\n"
+     << "}\n\n";
+}
+
+
+// Write a function that returns a long chain of arithmetic,
+// including calls to previously defined functions.
+void
+chain(std::ostream& os, int n, Synth_options const& opts)
+{
+  static char const* ops[] = {" + ", " - ", " * ", " % "};
+  os << "def chain" << n << "(a : int, b : int) -> int\n"
+     << "{\n"
+     << "  return a";
+  for (int i = 1; i < opts.chain; ++i) {
+    os << ops[i % 4];
+    if (i % 4 == 3)
+      os << (i + 1);
+    else if (i % 8 == 1 && n > 0)
+      os << "nest" << (n - 1) / 2 << "(b)";
+    else if (i == 5 && n > 0)
+      os << "chain" << n - 1 << "(b, a)";
+    else
+      os << (i % 2 ? 'b' : 'a');
+    if (i % 6 == 0)
+      os << "\n        ";
+  }
+  os << ";\n"
+     << "}\n\n";
+}
+
+} // namespace
+
+
+// Write a program of approximately opts.lines lines to
+// the output stream. Returns the number of lines written.
+std::size_t
+synthesize(std::ostream& os, Synth_options const& opts)
+{
+  std::size_t lines = 0;
+  int n = 0;
+  while (lines < opts.lines) {
+    std::stringstream ss;
+    if (n % 8 == 0)
+      record(ss, n / 8, opts);
+    if (n % 16 == 0)
+      array(ss, n / 16, opts);
+    nest(ss, n, opts);
+    chain(ss, n, opts);
+
+    String s = ss.str();
+    lines += std::count(s.begin(), s.end(), '\n');
+    os << s;
+    ++n;
+  }
+
+  os << "def main() -> int\n"
+     << "{\n"
+     << "  return chain" << n - 1 << "(1, 2);\n"
+     << "}\n";
+  return lines + 4;
+}
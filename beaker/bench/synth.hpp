@@ -0,0 +1,38 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_BENCH_SYNTH_HPP
+#define BEAKER_BENCH_SYNTH_HPP
+
+// The synthesizer writes large, valid Beaker programs for
+// scalability testing. A program is a sequence of units,
+// each of which stresses a different part of translation:
+//
+//    - records with many fields, each nesting the previous
+//      record,
+//    - globals of huge array type, with an accessor,
+//    - functions with deeply nested blocks, and
+//    - functions with long expression chains that call
+//      previously defined functions.
+//
+// Units are emitted until the program reaches the requested
+// number of lines. The program ends with a main function.
+
+#include <iosfwd>
+#include <cstddef>
+
+
+struct Synth_options
+{
+  std::size_t lines = 1000;    // Approximate number of lines
+  int         depth = 8;       // Nesting depth of blocks
+  int         chain = 32;      // Terms in an expression chain
+  int         fields = 16;     // Fields per record
+  int         extent = 100000; // Extent of array types
+};
+
+
+std::size_t synthesize(std::ostream&, Synth_options const&);
+
+
+#endif
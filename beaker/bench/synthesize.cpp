@@ -0,0 +1,48 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+// Write a synthetic Beaker program to standard output.
+//
+//    beaker-synth [options]
+//
+//    -lines <n>    Approximate number of lines (default 1000)
+//    -depth <n>    Nesting depth of blocks (default 8)
+//    -chain <n>    Terms in an expression chain (default 32)
+//    -fields <n>   Fields per record (default 16)
+//    -extent <n>   Extent of array types (default 100000)
+
+#include "synth.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+int
+main(int argc, char* argv[])
+{
+  Synth_options opts;
+  for (int i = 1; i < argc; ++i) {
+    char const* arg = argv[i];
+    if (i + 1 == argc) {
+      std::cerr << "error: invalid option '" << arg << "'\n";
+      return -1;
+    }
+    long n = std::atol(argv[++i]);
+    if (!std::strcmp(arg, "-lines"))
+      opts.lines = n;
+    else if (!std::strcmp(arg, "-depth"))
+      opts.depth = n;
+    else if (!std::strcmp(arg, "-chain"))
+      opts.chain = n;
+    else if (!std::strcmp(arg, "-fields"))
+      opts.fields = n;
+    else if (!std::strcmp(arg, "-extent"))
+      opts.extent = n;
+    else {
+      std::cerr << "error: invalid option '" << arg << "'\n";
+      return -1;
+    }
+  }
+  synthesize(std::cout, opts);
+}
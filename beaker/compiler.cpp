@@ -6,9 +6,14 @@
 #include "elaborator.hpp"
 #include "generator.hpp"
 #include "error.hpp"
+#include "options.hpp"
+#include "phase.hpp"
+#include "stats.hpp"
+#include "metrics.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <memory>
 
 #include <llvm/IR/Module.h>
 #include <llvm/Support/raw_ostream.h>
@@ -20,47 +25,81 @@ using namespace std;
 int
 main(int argc, char* argv[])
 {
-  // Prepare the symbol table.
-  Symbol_table syms;
-  init_symbols(syms);
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+  if (opts.time)
+    time_report().enable();
+  if (opts.mem)
+    memory_report().enable();
+  if (opts.trace)
+    trace_log().enable(opts.trace);
+
+  // Prepare the symbol table. The threads that lex in
+  // parallel intern symbols in a concurrent table.
+  Symbol_table table;
+  std::unique_ptr<Concurrent_symbol_table> shared;
+  if (opts.lex_threads > 1)
+    shared.reset(new Concurrent_symbol_table);
+  Symbol_table_ref syms = shared ? Symbol_table_ref(*shared) : Symbol_table_ref(table);
 
   // Prepare the input buffer.
-  //
-  // FIXME: Handle command line arguments.
-  File src = argv[1];
-  Input_buffer in = src;
+  File src = opts.input;
+  Input_buffer in(src);
 
   try {
-    // Create the token stream over. This will be populated
-    // by the lexer.
-    Token_stream ts;
-
-    // Build and run the lexer.
-    Lexer lex(syms, in);
-    if (!lex.lex(ts))
+    // Create the token stream. This is populated by the
+    // lexer, either all at once or, when lexing lazily, as
+    // the parser requests tokens. In the latter case, lexing
+    // time is included in the parsing time.
+    Phase_sentinel lex_phase(lexing_time);
+    Literal_pool lits;
+    Lexer lex(syms, lits, in);
+    Token_stream ts(opts.lazy_lex ? &lex : nullptr);
+    if (!opts.lazy_lex && !lex.lex(ts, opts.lex_threads, opts.lex_chunk))
       return -1;
+    lex_phase.stop();
 
     // Build and run the parser. The location map
     // is used to save source locations, which are
     // used to diagnose elaboration errors.
+    Phase_sentinel parse_phase(parsing_time);
     Location_map locs;
-    Parser parse(syms, ts, locs);
+    Parser parse(syms, lits, ts, locs);
     Decl* m = parse.module();
-    if (!parse)
+    if (!parse || lex.failed())
       return -1;
+    lits.clear();  // Literals are not needed after parsing
+    parse_phase.stop();
 
     // Perform semantic analysis.
     //
     // TODO: Implement a parse-only phase.
+    Phase_sentinel elab_phase(elaboration_time);
     Elaborator elab(locs);
     elab.elaborate(m);
+    elab_phase.stop();
 
     // Translate to LLVM.
     //
     // TODO: Support translation to other models?
+    Phase_sentinel gen_phase(generation_time);
     Generator gen;
     llvm::Module* mod = gen(m);
-    llvm::outs() << *mod;
+    gen_phase.stop();
+
+    // Report the quality of the generated code instead
+    // of printing it.
+    if (opts.metrics) {
+      Module_metrics before = measure(*mod);
+      optimize(*mod);
+      print_metrics(std::cout, before, measure(*mod));
+    } else {
+      Phase_sentinel print_phase(printing_time);
+      llvm::outs() << *mod;
+      llvm::outs().flush();
+      print_phase.stop();
+    }
   }
 
   // Diagnose uncaught translation errors and exit
@@ -73,5 +112,16 @@ main(int argc, char* argv[])
     return -1;
   }
 
+  if (opts.time)
+    time_report().print(std::cerr);
+  if (opts.mem)
+    memory_report().print(std::cerr);
+  if (opts.stats == table_stats)
+    stats().print(std::cerr);
+  else if (opts.stats == json_stats)
+    stats().print_json(std::cerr);
+  if (opts.trace && !trace_log().write())
+    return -1;
+
   // FIXME: Do something with the module.
 }
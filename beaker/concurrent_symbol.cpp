@@ -0,0 +1,98 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "concurrent_symbol.hpp"
+
+
+// The reserved symbols are shared with all other tables,
+// and have the indexes 1 through the number of reserved
+// symbols.
+Concurrent_symbol_table::Concurrent_symbol_table()
+{
+  for (Stripe& st : stripes_) {
+    st.tables.emplace_back(new Table(init_slots));
+    st.table.store(st.tables.back().get(), std::memory_order_relaxed);
+  }
+  for (std::atomic<Entry*>& seg : segments_)
+    seg.store(nullptr, std::memory_order_relaxed);
+
+  std::vector<Symbol*> const& rs = reserved_symbols();
+  reserved_ = rs.size() - 1;
+  next_.store(rs.size(), std::memory_order_relaxed);
+  for (std::uint32_t i = 1; i < rs.size(); ++i)
+    entry(i).store(rs[i], std::memory_order_relaxed);
+  memory_report().allocate<Slot>(init_slots << stripe_bits);
+}
+
+
+// Destroy the symbols owned by the table. Their storage is
+// released with the arenas of the stripes. This must not
+// run concurrently with any other use of the table.
+Concurrent_symbol_table::~Concurrent_symbol_table()
+{
+  for (std::uint32_t i = reserved_ + 1; i < size(); ++i) {
+    if (Symbol const* sym = symbol(i))
+      sym->~Symbol();
+  }
+  for (std::atomic<Entry*>& seg : segments_)
+    delete[] seg.load(std::memory_order_relaxed);
+}
+
+
+// Returns the entry for the symbol with index n, allocating
+// its segment if needed. Threads may race to allocate the
+// same segment; the loser frees its copy.
+Concurrent_symbol_table::Entry&
+Concurrent_symbol_table::entry(std::uint32_t n)
+{
+  std::size_t m = n + first_segment;
+  int k = segment(m);
+  Entry* seg = segments_[k].load(std::memory_order_acquire);
+  if (!seg) {
+    std::size_t len = first_segment << k;
+    Entry* p = new Entry[len];
+    for (std::size_t i = 0; i < len; ++i)
+      p[i].store(nullptr, std::memory_order_relaxed);
+    if (segments_[k].compare_exchange_strong(seg, p, std::memory_order_acq_rel))
+      seg = p;
+    else
+      delete[] p;
+  }
+  return seg[m - (first_segment << k)];
+}
+
+
+// Returns the first empty slot probed for the hash h.
+// The caller holds the lock of the stripe of t.
+Concurrent_symbol_table::Slot&
+Concurrent_symbol_table::empty_slot(Table& t, std::size_t h)
+{
+  std::size_t i = h & t.mask;
+  while (t.slots[i].sym.load(std::memory_order_relaxed))
+    i = (i + 1) & t.mask;
+  return t.slots[i];
+}
+
+
+// Replace the table of the stripe st by one with twice as
+// many slots, reinserting each symbol by its stored hash.
+// The old table is retired, not freed, since lookups may
+// still be probing it. The caller holds the stripe's lock.
+void
+Concurrent_symbol_table::grow(Stripe& st)
+{
+  Table const& old = *st.table.load(std::memory_order_relaxed);
+  std::unique_ptr<Table> t(new Table(2 * (old.mask + 1)));
+  for (std::size_t i = 0; i <= old.mask; ++i) {
+    Slot const& x = old.slots[i];
+    if (Symbol* sym = x.sym.load(std::memory_order_relaxed)) {
+      std::size_t h = x.hash.load(std::memory_order_relaxed);
+      Slot& y = empty_slot(*t, h);
+      y.hash.store(h, std::memory_order_relaxed);
+      y.sym.store(sym, std::memory_order_relaxed);
+    }
+  }
+  st.tables.push_back(std::move(t));
+  st.table.store(st.tables.back().get(), std::memory_order_release);
+  memory_report().allocate<Slot>(2 * (old.mask + 1));
+}
@@ -0,0 +1,259 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_CONCURRENT_SYMBOL_HPP
+#define BEAKER_CONCURRENT_SYMBOL_HPP
+
+// The concurrent symbol table interns symbols from many
+// threads at once (e.g., the lexers and parsers of several
+// chunks or modules). Its symbols have the same identity as
+// those of the Symbol_table: each spelling is interned once,
+// and its symbol is not moved or freed until the table is
+// destroyed, so symbols interned by different threads can
+// be compared by address.
+//
+// The table is divided into stripes by the high bits of the
+// hash of a spelling. Each stripe is an open addressing table
+// with linear probing, like the Symbol_table, and insertions
+// into a stripe are serialized by its lock. Lookups take no
+// locks. A slot is filled once, by a release store of its
+// symbol, and never changes after that. When a stripe grows,
+// its old slots are kept until the table is destroyed, so a
+// lookup still probing them is not affected. A stripe is at
+// most half full, so a lookup finishes in a bounded number
+// of steps whatever the other threads do; it is wait-free.
+//
+// Symbols are numbered as they are added, and are found by
+// index through a segmented array whose segments are never
+// moved.
+
+#include "symbol.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+
+class Concurrent_symbol_table
+{
+public:
+  Concurrent_symbol_table();
+  Concurrent_symbol_table(Concurrent_symbol_table const&) = delete;
+  Concurrent_symbol_table& operator=(Concurrent_symbol_table const&) = delete;
+  ~Concurrent_symbol_table();
+
+  template<typename T, typename... Args>
+  Symbol* put(String_ref, Args&&...);
+
+  template<typename T, typename... Args>
+  Symbol* put(char const*, char const*, Args&&...);
+
+  Symbol const* get(String_ref) const;
+  Symbol const* symbol(std::uint32_t) const;
+
+  std::uint32_t size() const;
+
+private:
+  struct Slot
+  {
+    std::atomic<std::size_t> hash;
+    std::atomic<Symbol*>     sym;   // Null if the slot is empty
+  };
+
+  struct Table
+  {
+    explicit Table(std::size_t n)
+      : mask(n - 1), slots(new Slot[n]())
+    { }
+
+    std::size_t             mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  struct Stripe
+  {
+    std::mutex                          mutex;
+    std::atomic<Table*>                 table;
+    std::size_t                         count = 0;  // Symbols in the stripe
+    Arena                               arena;      // Storage for symbols
+    std::vector<std::unique_ptr<Table>> tables;     // Including retired tables
+  };
+
+  using Entry = std::atomic<Symbol*>;
+
+  static constexpr int         stripe_bits = 5;
+  static constexpr std::size_t init_slots = 16;
+  static constexpr int         segment_bits = 6;
+  static constexpr std::size_t first_segment = 1 << segment_bits;
+  static constexpr int         num_segments = 19;   // Enough for max_symbols
+
+  template<typename T>
+  static Symbol* checked(Symbol*);
+
+  static int     segment(std::size_t);
+  static Symbol* find(Table const&, String_ref, std::size_t);
+  static Slot&   empty_slot(Table&, std::size_t);
+
+  Stripe& stripe(std::size_t h) const;
+  Entry&  entry(std::uint32_t);
+  void    grow(Stripe&);
+
+  template<typename T, typename... Args>
+  Symbol* insert(Stripe&, String_ref, std::size_t, Args&&...);
+
+  mutable Stripe             stripes_[1 << stripe_bits];
+  std::atomic<Entry*>        segments_[num_segments];
+  std::atomic<std::uint32_t> next_;      // The index of the next symbol
+  std::uint32_t              reserved_;  // The number of reserved symbols
+};
+
+
+// Returns the stripe for symbols whose hash is h.
+inline Concurrent_symbol_table::Stripe&
+Concurrent_symbol_table::stripe(std::size_t h) const
+{
+  return stripes_[h >> (8 * sizeof(std::size_t) - stripe_bits)];
+}
+
+
+// Returns the segment containing the entry at position m
+// of the segmented array, which is the symbol index plus
+// the size of the first segment. The kth segment starts
+// at position first_segment << k.
+inline int
+Concurrent_symbol_table::segment(std::size_t m)
+{
+  return 8 * sizeof(unsigned long long) - 1 - __builtin_clzll(m) - segment_bits;
+}
+
+
+// Returns the symbol in t with the spelling s, whose hash
+// is h, or nullptr if there is none.
+inline Symbol*
+Concurrent_symbol_table::find(Table const& t, String_ref s, std::size_t h)
+{
+  std::size_t i = h & t.mask;
+  while (true) {
+    Slot const& x = t.slots[i];
+    Symbol* sym = x.sym.load(std::memory_order_acquire);
+    if (!sym)
+      return nullptr;
+    if (x.hash.load(std::memory_order_relaxed) == h && sym->spelling() == s)
+      return sym;
+    i = (i + 1) & t.mask;
+  }
+}
+
+
+// Returns sym if it has the type T. Otherwise, the
+// spelling has been redefined as a different kind of
+// symbol, which is an error.
+template<typename T>
+inline Symbol*
+Concurrent_symbol_table::checked(Symbol* sym)
+{
+  if (typeid(T) != typeid(*sym))
+    throw std::runtime_error("redefinition of symbol");
+  return sym;
+}
+
+
+// Insert a new symbol into the table, as with the
+// Symbol_table. If the symbol exists, it is found without
+// taking a lock. Otherwise, the symbol is added under the
+// lock of its stripe, unless another thread has added it
+// first.
+template<typename T, typename... Args>
+Symbol*
+Concurrent_symbol_table::put(String_ref s, Args&&... args)
+{
+  if (std::uint32_t n = reserved_index(s))
+    return checked<T>(reserved_symbols()[n]);
+  std::size_t h = String_hash()(s);
+  Stripe& st = stripe(h);
+  if (Symbol* sym = find(*st.table.load(std::memory_order_acquire), s, h))
+    return checked<T>(sym);
+
+  std::lock_guard<std::mutex> lock(st.mutex);
+  if (Symbol* sym = find(*st.table.load(std::memory_order_relaxed), s, h))
+    return checked<T>(sym);
+  return insert<T>(st, s, h, std::forward<Args>(args)...);
+}
+
+
+// Insert a symbol with the spelling [first, last) and
+// the properties in args...
+template<typename T, typename... Args>
+inline Symbol*
+Concurrent_symbol_table::put(char const* first, char const* last, Args&&... args)
+{
+  return this->template put<T>(String_ref(first, last - first), std::forward<Args>(args)...);
+}
+
+
+// Create the symbol with the spelling s, whose hash is h,
+// in the stripe st. The caller holds the stripe's lock. The
+// symbol is complete, and can be found by its index, before
+// it is published in the stripe.
+template<typename T, typename... Args>
+Symbol*
+Concurrent_symbol_table::insert(Stripe& st, String_ref s, std::size_t h, Args&&... args)
+{
+  if (2 * (st.count + 1) > st.table.load(std::memory_order_relaxed)->mask + 1)
+    grow(st);
+  std::uint32_t n = next_.fetch_add(1, std::memory_order_relaxed);
+  if (n > max_symbols)
+    throw std::runtime_error("too many symbols");
+  Symbol* sym = st.arena.make<T>(std::forward<Args>(args)...);
+  sym->str_.assign(s.begin(), s.end());
+  sym->id_ = n;
+  entry(n).store(sym, std::memory_order_release);
+
+  Slot& x = empty_slot(*st.table.load(std::memory_order_relaxed), h);
+  x.hash.store(h, std::memory_order_relaxed);
+  x.sym.store(sym, std::memory_order_release);
+  ++st.count;
+  ++interned_symbols;
+  memory_report().allocate<T>();
+  return sym;
+}
+
+
+// Returns the symbol with the given spelling or
+// nullptr if no such symbol exists.
+inline Symbol const*
+Concurrent_symbol_table::get(String_ref s) const
+{
+  if (std::uint32_t n = reserved_index(s))
+    return reserved_symbols()[n];
+  std::size_t h = String_hash()(s);
+  return find(*stripe(h).table.load(std::memory_order_acquire), s, h);
+}
+
+
+// Returns the symbol with index n, or nullptr if n is
+// 0 or no symbol has been added with that index.
+inline Symbol const*
+Concurrent_symbol_table::symbol(std::uint32_t n) const
+{
+  if (n >= size())
+    return nullptr;
+  std::size_t m = n + first_segment;
+  int k = segment(m);
+  Entry const* seg = segments_[k].load(std::memory_order_acquire);
+  if (!seg)
+    return nullptr;
+  return seg[m - (first_segment << k)].load(std::memory_order_acquire);
+}
+
+
+// Returns the number of symbol indexes that have been
+// used, including 0.
+inline std::uint32_t
+Concurrent_symbol_table::size() const
+{
+  return std::min<std::uint32_t>(next_.load(std::memory_order_relaxed), max_symbols + 1);
+}
+
+
+#endif
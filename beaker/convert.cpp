@@ -3,6 +3,7 @@
 #include "type.hpp"
 #include "expr.hpp"
 #include "decl.hpp"
+#include "make.hpp"
 
 #include <iostream>
 
@@ -14,7 +15,7 @@ Expr*
 convert_to_value(Expr* e)
 {
   if (Reference_type const* t = as<Reference_type>(e->type()))
-    return new Value_conv(t->nonref(), e);
+    return make<Value_conv>(t->nonref(), e);
   else
     return e;
 }
@@ -26,7 +27,7 @@ Expr*
 convert_to_block(Expr* e)
 {
   if (Array_type const* a = as<Array_type>(e->type()))
-    return new Block_conv(get_block_type(a->type()), e);
+    return make<Block_conv>(get_block_type(a->type()), e);
   else
     return e;
 }
@@ -9,6 +9,8 @@
 #include "convert.hpp"
 #include "evaluator.hpp"
 #include "error.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
 
 #include <iostream>
 
@@ -27,6 +29,7 @@ Scope_stack::declare(Decl* d)
 
   // TODO: If we allow overloading, then this is
   // where we would handle that.
+  Timer_sentinel timer(lookup_time);
   if (scope.lookup(d->name())) {
     // TODO: Add a note that points to the previous
     // definition.
@@ -35,6 +38,8 @@ Scope_stack::declare(Decl* d)
     throw Lookup_error({}, ss.str());
   }
 
+  timer.stop();
+
   // Create the binding.
   scope.bind(d->name(), d);
 
@@ -43,6 +48,15 @@ Scope_stack::declare(Decl* d)
 }
 
 
+// Returns the innermost binding for the symbol.
+Scope::Binding const*
+Scope_stack::lookup(Symbol const* s) const
+{
+  Timer_sentinel timer(lookup_time);
+  return Stack<Scope>::lookup(s);
+}
+
+
 // Returns the innermost declaration context.
 Decl*
 Scope_stack::context() const
@@ -846,6 +860,7 @@ Elaborator::elaborate(Variable_decl* d)
 Decl*
 Elaborator::elaborate(Function_decl* d)
 {
+  Cost_sentinel cost(elaboration_cost, d);
   d->type_ = elaborate(d->type_);
 
   // Declare the function.
@@ -916,8 +931,10 @@ Decl*
 Elaborator::elaborate(Module_decl* m)
 {
   Scope_sentinel scope(*this, m);
-  for (Decl*& d : m->decls_)
+  for (Decl*& d : m->decls_) {
+    Trace_span span("elaborate", d->name()->spelling().c_str());
     d = elaborate(d);
+  }
   return m;
 }
 
@@ -56,6 +56,8 @@ struct Scope_stack : Stack<Scope>
   Module_decl*   module() const;
   Function_decl* function() const;
 
+  Binding const* lookup(Symbol const*) const;
+
   void declare(Decl*);
 };
 
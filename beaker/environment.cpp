@@ -3,3 +3,9 @@
 
 #include "environment.hpp"
 
+
+// The average probe depth of a lookup is the ratio of
+// probes to lookups.
+Counter stack_lookups("stack.lookups", "lookups in an environment stack");
+Counter stack_probes("stack.probes", "environments searched by lookups");
+
@@ -4,6 +4,8 @@
 #ifndef BEAKER_ENVIRONMENT_HPP
 #define BEAKER_ENVIRONMENT_HPP
 
+#include "stats.hpp"
+
 #include <cassert>
 #include <unordered_map>
 #include <vector>
@@ -105,6 +107,10 @@ Environment<S, T>::lookup(S const& sym) -> Binding*
 }
 
 
+extern Counter stack_lookups;
+extern Counter stack_probes;
+
+
 // The stack maintains the nested binding environments at
 // certain point in the program. Symbol lookup is processed
 // in the innermost environment, and works outward.
@@ -149,15 +155,20 @@ Stack<E>::pop()
 }
 
 
+// Returns the innermost binding of n. Probes are counted
+// once per lookup rather than once per probe, to keep the
+// counters out of the loop.
 template<typename E>
 auto
 Stack<E>::lookup(Name const& n) const -> Binding const*
 {
-  for (auto iter = this->rbegin(); iter != this->rend(); ++iter) {
-    if (Binding const* bind = iter->lookup(n))
-      return bind;
-  }
-  return nullptr;
+  ++stack_lookups;
+  Binding const* bind = nullptr;
+  auto iter = this->rbegin();
+  while (iter != this->rend() && !(bind = iter->lookup(n)))
+    ++iter;
+  stack_probes += (iter - this->rbegin()) + (bind != nullptr);
+  return bind;
 }
 
 
@@ -165,11 +176,13 @@ template<typename E>
 auto
 Stack<E>::lookup(Name const& n) -> Binding*
 {
-  for (auto iter = this->rbegin(); iter != this->rend(); ++iter) {
-    if (Binding* bind = iter->lookup(n))
-      return bind;
-  }
-  return nullptr;
+  ++stack_lookups;
+  Binding* bind = nullptr;
+  auto iter = this->rbegin();
+  while (iter != this->rend() && !(bind = iter->lookup(n)))
+    ++iter;
+  stack_probes += (iter - this->rbegin()) + (bind != nullptr);
+  return bind;
 }
 
 
@@ -7,16 +7,142 @@
 #include "decl.hpp"
 #include "stmt.hpp"
 #include "error.hpp"
+#include "trace.hpp"
+#include "make.hpp"
 
+#include <chrono>
 #include <iostream>
+#include <algorithm>
 
 
+Counter pushed_frames("store.frames", "store frames pushed");
+
+
+namespace
+{
+
+// Returns the initial count of a resource bounded by
+// the limit n.
+inline std::size_t
+bound(std::size_t n)
+{
+  return n ? n : std::size_t(-1);
+}
+
+
+// Take the memory for n values from the remaining heap.
+void
+reserve(std::size_t& heap, std::size_t n)
+{
+  if (n > heap / sizeof(Value))
+    limit_exceeded("heap limit exceeded");
+  heap -= n * sizeof(Value);
+}
+
+
+// Returns a copy of the aggregate a, and of the aggregates
+// it contains, taking its memory from the remaining heap.
+template<typename T>
+T
+copy_aggregate(T const& a, std::size_t& heap)
+{
+  reserve(heap, a.len);
+  T v(a.len);
+  for (std::size_t i = 0; i < v.len; ++i) {
+    Value const& x = a.data[i];
+    if (x.is_array())
+      v.data[i] = copy_aggregate(x.get_array(), heap);
+    else if (x.is_tuple())
+      v.data[i] = copy_aggregate(x.get_tuple(), heap);
+    else
+      v.data[i] = x;
+  }
+  return v;
+}
+
+} // namespace
+
+
+// Fail the evaluation of a program that has exceeded
+// one of its limits. This is kept out of line so that
+// checking a limit costs only a test and a branch.
+void
+limit_exceeded(char const* msg)
+{
+  throw Evaluation_error({}, msg);
+}
+
+
+void
+limit_exceeded(Location loc, char const* msg)
+{
+  throw Evaluation_error(loc, msg);
+}
+
+
+// Create an evaluator bounded by the limits l. If the
+// source locations of the program are given, they are
+// used to diagnose exceeded limits.
+template<typename P>
+Basic_evaluator<P>::Basic_evaluator(Limits const& l, Location_map const* m)
+  : fuel(bound(l.fuel)), heap(bound(l.heap)), depth(bound(l.depth)), locs(m)
+{ }
+
+
+// Returns the source location of the node p, if known.
+template<typename P>
+Location
+Basic_evaluator<P>::locate(void const* p) const
+{
+  return locs ? locs->get(p) : Location();
+}
+
+
+// Call y after every n units of fuel are spent.
+template<typename P>
+void
+Basic_evaluator<P>::preempt(std::size_t n, Yield& y)
+{
+  std::size_t total = fuel + reserve;
+  slice = n;
+  yield = &y;
+  fuel = std::min(n, total);
+  reserve = total - fuel;
+}
+
+
+// Spend one unit of fuel for the call or loop p.
+template<typename P>
+inline void
+Basic_evaluator<P>::burn(void const* p)
+{
+  if (fuel == 0)
+    refuel(p);
+  --fuel;
+}
+
+
+// Start a new slice, yielding if the evaluator is
+// preemptible. Fails at p if there is no fuel left.
+template<typename P>
+void
+Basic_evaluator<P>::refuel(void const* p)
+{
+  if (!yield || reserve == 0)
+    limit_exceeded(locate(p), "fuel exhausted");
+  (*yield)();
+  fuel = std::min(slice, reserve);
+  reserve -= fuel;
+}
+
+
+template<typename P>
 Value
-Evaluator::eval(Expr const* e)
+Basic_evaluator<P>::eval(Expr const* e)
 {
   struct Fn
   {
-    Evaluator& ev;
+    Basic_evaluator& ev;
 
     Value operator()(Literal_expr const* e) { return ev.eval(e); }
     Value operator()(Id_expr const* e) { return ev.eval(e); }
@@ -49,23 +175,42 @@ Evaluator::eval(Expr const* e)
 }
 
 
+// The value of an aggregate literal is owned by the AST,
+// which is shared by every evaluation of the program (e.g.,
+// the tasks of a scheduler). The literal is copied so that
+// an object initialized by it does not modify the AST.
+template<typename P>
 Value
-Evaluator::eval(Literal_expr const* e)
+Basic_evaluator<P>::eval(Literal_expr const* e)
 {
-  return e->value();
+  Value const& v = e->value();
+  if (v.is_array())
+    return copy_aggregate(v.get_array(), heap);
+  if (v.is_tuple())
+    return copy_aggregate(v.get_tuple(), heap);
+  return v;
 }
 
 
+// An identifier that names an object evaluates to a
+// reference to that object. Otherwise, the identifier
+// names a function and evaluates to its value.
+template<typename P>
 Value
-Evaluator::eval(Id_expr const* e)
+Basic_evaluator<P>::eval(Id_expr const* e)
 {
-  return &stack.lookup(e->symbol())->second;
+  Value& v = stack.lookup(e->symbol())->second;
+  if (defines_object(e->declaration()))
+    return &v;
+  else
+    return v;
 }
 
 
 // TODO: Detect overflow.
+template<typename P>
 Value
-Evaluator::eval(Add_expr const* e)
+Basic_evaluator<P>::eval(Add_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -74,8 +219,9 @@ Evaluator::eval(Add_expr const* e)
 
 
 // TODO: Detect overflow.
+template<typename P>
 Value
-Evaluator::eval(Sub_expr const* e)
+Basic_evaluator<P>::eval(Sub_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -84,8 +230,9 @@ Evaluator::eval(Sub_expr const* e)
 
 
 // TODO: Detect overflow.
+template<typename P>
 Value
-Evaluator::eval(Mul_expr const* e)
+Basic_evaluator<P>::eval(Mul_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -93,8 +240,9 @@ Evaluator::eval(Mul_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Div_expr const* e)
+Basic_evaluator<P>::eval(Div_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -104,27 +252,30 @@ Evaluator::eval(Div_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Rem_expr const* e)
+Basic_evaluator<P>::eval(Rem_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
   if (v2.get_integer() == 0)
     throw std::runtime_error("division by 0");
-  return v1.get_integer() / v2.get_integer();
+  return v1.get_integer() % v2.get_integer();
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Neg_expr const* e)
+Basic_evaluator<P>::eval(Neg_expr const* e)
 {
   Value v = eval(e->operand());
   return -v.get_integer();
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Pos_expr const* e)
+Basic_evaluator<P>::eval(Pos_expr const* e)
 {
   return eval(e->operand());
 }
@@ -150,8 +301,9 @@ compare_equal(Value const& v1, Value const& v2, F fn)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Eq_expr const* e)
+Basic_evaluator<P>::eval(Eq_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -160,8 +312,9 @@ Evaluator::eval(Eq_expr const* e)
 
 
 // Compare two integer or function values.
+template<typename P>
 Value
-Evaluator::eval(Ne_expr const* e)
+Basic_evaluator<P>::eval(Ne_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -185,8 +338,9 @@ compare_less(Value const& v1, Value const& v2, F fn)
 }
 
 // Order two integer values.
+template<typename P>
 Value
-Evaluator::eval(Lt_expr const* e)
+Basic_evaluator<P>::eval(Lt_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -194,8 +348,9 @@ Evaluator::eval(Lt_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Gt_expr const* e)
+Basic_evaluator<P>::eval(Gt_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -203,8 +358,9 @@ Evaluator::eval(Gt_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Le_expr const* e)
+Basic_evaluator<P>::eval(Le_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -212,8 +368,9 @@ Evaluator::eval(Le_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Ge_expr const* e)
+Basic_evaluator<P>::eval(Ge_expr const* e)
 {
   Value v1 = eval(e->left());
   Value v2 = eval(e->right());
@@ -221,8 +378,9 @@ Evaluator::eval(Ge_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(And_expr const* e)
+Basic_evaluator<P>::eval(And_expr const* e)
 {
   Value v = eval(e->left());
   if (!v.get_integer())
@@ -232,8 +390,9 @@ Evaluator::eval(And_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Or_expr const* e)
+Basic_evaluator<P>::eval(Or_expr const* e)
 {
   Value v = eval(e->left());
   if (v.get_integer())
@@ -243,20 +402,24 @@ Evaluator::eval(Or_expr const* e)
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Not_expr const* e)
+Basic_evaluator<P>::eval(Not_expr const* e)
 {
   Value v = eval(e->operand());
   return !v.get_integer();
 }
 
 
+template<typename P>
 Value
-Evaluator::eval(Call_expr const* e)
+Basic_evaluator<P>::eval(Call_expr const* e)
 {
   // Evaluate the function expression.
   Value v = eval(e->target());
   Function_decl const* f = v.get_function();
+  if (!f->body())
+    throw Evaluation_error({}, "cannot evaluate a call to a foreign function");
 
   // Evaluate each argument in turn.
   Value_seq args;
@@ -270,6 +433,8 @@ Evaluator::eval(Call_expr const* e)
   // FIXME: Since everything type-checked, these *must*
   // happen to magically line up. However, it would be
   // a good idea to verify.
+  burn(e);
+  Call_sentinel call(*this, f, e);
   Store_sentinel frame(*this);
   for (std::size_t i = 0; i < args.size(); ++i) {
     Decl* p = f->parameters()[i];
@@ -285,15 +450,15 @@ Evaluator::eval(Call_expr const* e)
   Control ctl = eval(f->body(), result);
   if (ctl != return_ctl)
     throw std::runtime_error("function evaluation failed");
-
   return result;
 }
 
 
 // Return a reference to the object at the
 // requested field.
+template<typename P>
 Value
-Evaluator::eval(Member_expr const* e)
+Basic_evaluator<P>::eval(Member_expr const* e)
 {
   Value obj = eval(e->scope());
   Value* ref = obj.get_reference();
@@ -302,8 +467,9 @@ Evaluator::eval(Member_expr const* e)
 
 
 // Return a reference to nth element of an array.
+template<typename P>
 Value
-Evaluator::eval(Index_expr const* e)
+Basic_evaluator<P>::eval(Index_expr const* e)
 {
   Value arr = eval(e->array());
   Value* ref = arr.get_reference();
@@ -315,8 +481,9 @@ Evaluator::eval(Index_expr const* e)
 // Apply an object-to-value conversion by dereferencing
 // the reference value. Note that the source must evaluate
 // to a reference.
+template<typename P>
 Value
-Evaluator::eval(Value_conv const* e)
+Basic_evaluator<P>::eval(Value_conv const* e)
 {
   Value v = eval(e->source());
   return *v.get_reference();
@@ -326,8 +493,9 @@ Evaluator::eval(Value_conv const* e)
 // Apply an array-to-block conversion by dereferencing
 // the reference value. Note that the source must evaluate
 // to a reference.
+template<typename P>
 Value
-Evaluator::eval(Block_conv const* e)
+Basic_evaluator<P>::eval(Block_conv const* e)
 {
   throw std::runtime_error("not implemented");
 }
@@ -335,8 +503,9 @@ Evaluator::eval(Block_conv const* e)
 
 // FIXME: This is wrong. We should be calling a function
 // that default initializes the created object.
+template<typename P>
 Value
-Evaluator::eval(Default_init const* e)
+Basic_evaluator<P>::eval(Default_init const* e)
 {
   throw std::runtime_error("not reachable");
 }
@@ -344,8 +513,9 @@ Evaluator::eval(Default_init const* e)
 
 // FIXME: This should be calling a function that
 // default iniitializes the created object.
+template<typename P>
 Value
-Evaluator::eval(Copy_init const* e)
+Basic_evaluator<P>::eval(Copy_init const* e)
 {
   lingo_unreachable();
 }
@@ -354,12 +524,13 @@ Evaluator::eval(Copy_init const* e)
 // -------------------------------------------------------------------------- //
 // Evaluation of declarations
 
+template<typename P>
 void
-Evaluator::eval(Decl const* d)
+Basic_evaluator<P>::eval(Decl const* d)
 {
   struct Fn
   {
-    Evaluator& ev;
+    Basic_evaluator& ev;
 
     void operator()(Variable_decl const* d) { ev.eval(d); }
     void operator()(Function_decl const* d) { ev.eval(d); }
@@ -377,13 +548,16 @@ namespace
 {
 
 // Allocate a value whose shape is determined
-// by the type. No guarantees are made about the
-// contents of the resulting value.
+// by the type, taking its memory from the remaining
+// heap. No guarantees are made about the contents
+// of the resulting value.
 Value
-get_value(Type const* t)
+get_value(Type const* t, std::size_t& heap)
 {
   struct Fn
   {
+    std::size_t& heap;
+
     Value operator()(Id_type const*) { lingo_unreachable(); }
     
     // Produce an integer value.
@@ -401,9 +575,10 @@ get_value(Type const* t)
     // shaped by the element type.
     Value operator()(Array_type const* t) 
     {
+      reserve(heap, t->size());
       Array_value v(t->size());
       for (std::size_t i = 0; i < v.len; ++i)
-        v.data[i] = get_value(t->type());
+        v.data[i] = get_value(t->type(), heap);
       return v;
     }
     
@@ -425,25 +600,28 @@ get_value(Type const* t)
     { 
       Record_decl const* d = t->declaration();
       Decl_seq const& f = d->fields();
+      reserve(heap, f.size());
       Tuple_value v(f.size());
       for (std::size_t i = 0; i < v.len; ++i)
-        v.data[i] = get_value(f[i]->type());
+        v.data[i] = get_value(f[i]->type(), heap);
       return v;
     }
   };
-  return apply(t, Fn{});
+  return apply(t, Fn{heap});
 }
 
 } // namespace
 
 
+template<typename P>
 void
-Evaluator::eval(Variable_decl const* d)
+Basic_evaluator<P>::eval(Variable_decl const* d)
 {
   // Create an uninitialized object and bind it
   // to the symbol. Keep a reference so we can
   // initialize it directly.
-  Value v0 = get_value(d->type());
+  policy.on_alloc(d->type());
+  Value v0 = get_value(d->type(), heap);
   Value& v1 = stack.top().bind(d->name(), v0).second;
 
   // Handle initialization.
@@ -468,40 +646,45 @@ Evaluator::eval(Variable_decl const* d)
 
 
 // Bind the symbol to a function value.
+template<typename P>
 void
-Evaluator::eval(Function_decl const* d)
+Basic_evaluator<P>::eval(Function_decl const* d)
 {
   stack.top().bind(d->name(), d);
 }
 
 
 // This function should never be called.
+template<typename P>
 void
-Evaluator::eval(Parameter_decl const*)
+Basic_evaluator<P>::eval(Parameter_decl const*)
 {
   return;
 }
 
 
 // There is no evaluation for a record.
+template<typename P>
 void
-Evaluator::eval(Record_decl const*)
+Basic_evaluator<P>::eval(Record_decl const*)
 {
   return;
 }
 
 
 // There is no evaluation for a field.
+template<typename P>
 void
-Evaluator::eval(Field_decl const*)
+Basic_evaluator<P>::eval(Field_decl const*)
 {
   return;
 }
 
 
 // Evaluate the declarations in the module.
+template<typename P>
 void
-Evaluator::eval(Module_decl const* d)
+Basic_evaluator<P>::eval(Module_decl const* d)
 {
   Store_sentinel store(*this);
   for (Decl const* d1 : d->declarations())
@@ -516,12 +699,13 @@ Evaluator::eval(Module_decl const* d)
 // control instruction, which determines how
 // the evaluation proceeds. Storage is provided
 // for a return value as an output argument.
+template<typename P>
 Control
-Evaluator::eval(Stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Stmt const* s, Value& r)
 {
   struct Fn
   {
-    Evaluator& ev;
+    Basic_evaluator& ev;
     Value& r;
 
     Control operator()(Empty_stmt const* s) { return ev.eval(s, r); }
@@ -537,19 +721,22 @@ Evaluator::eval(Stmt const* s, Value& r)
     Control operator()(Declaration_stmt const* s) { return ev.eval(s, r); }
   };
 
+  policy.on_stmt(s);
   return apply(s, Fn{*this, r});
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Empty_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Empty_stmt const* s, Value& r)
 {
   return next_ctl;
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Block_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Block_stmt const* s, Value& r)
 {
   Store_sentinel store(*this);
   for(Stmt const* s1 : s->statements()) {
@@ -569,8 +756,9 @@ Evaluator::eval(Block_stmt const* s, Value& r)
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Assign_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Assign_stmt const* s, Value& r)
 {
   Value lhs = eval(s->object());
   Value rhs = eval(s->value());
@@ -579,8 +767,9 @@ Evaluator::eval(Assign_stmt const* s, Value& r)
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Return_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Return_stmt const* s, Value& r)
 {
   r = eval(s->value());
   return return_ctl;
@@ -589,8 +778,9 @@ Evaluator::eval(Return_stmt const* s, Value& r)
 
 // If the condition evaluates to true, then the body
 // is evaluated.
+template<typename P>
 Control
-Evaluator::eval(If_then_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(If_then_stmt const* s, Value& r)
 {
   Value c = eval(s->condition());
   if (c.get_integer())
@@ -604,8 +794,9 @@ Evaluator::eval(If_then_stmt const* s, Value& r)
 // Note that control stops if either branch returns,
 // breaks, or continues. In all other cases, control
 // flows to the next statement.
+template<typename P>
 Control
-Evaluator::eval(If_else_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(If_else_stmt const* s, Value& r)
 {
   Value c = eval(s->condition());
   if (c.get_integer())
@@ -617,8 +808,9 @@ Evaluator::eval(If_else_stmt const* s, Value& r)
 
 // Continue evaluationg the body while the condition
 // evaluates to true.
+template<typename P>
 Control
-Evaluator::eval(While_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(While_stmt const* s, Value& r)
 {
   while (true) {
     Value c = eval(s->condition());
@@ -628,6 +820,7 @@ Evaluator::eval(While_stmt const* s, Value& r)
     // Evaluate the body. Stop iterating if we got
     // a break, or return if we got a return.
     // Otherwise, continue to the next iteration.
+    burn(s);
     Control ctl = eval(s->body(), r);
     if (ctl == break_ctl)
       break;
@@ -638,30 +831,34 @@ Evaluator::eval(While_stmt const* s, Value& r)
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Break_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Break_stmt const* s, Value& r)
 {
   return break_ctl;
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Continue_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Continue_stmt const* s, Value& r)
 {
   return continue_ctl;
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Expression_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Expression_stmt const* s, Value& r)
 {
   eval(s->expression());
   return next_ctl;
 }
 
 
+template<typename P>
 Control
-Evaluator::eval(Declaration_stmt const* s, Value& r)
+Basic_evaluator<P>::eval(Declaration_stmt const* s, Value& r)
 {
   eval(s->declaration());
   return next_ctl;
@@ -685,7 +882,7 @@ reduce(Expr const* e)
   // Otherwise, try evaluating.
   try {
     Value v = evaluate(e);
-    return new Literal_expr(e->type(), v);
+    return make<Literal_expr>(e->type(), v);
   } catch (...) {
     return nullptr;
   }
@@ -695,24 +892,222 @@ reduce(Expr const* e)
 // -------------------------------------------------------------------------- //
 // Program execution
 
-// Execute the given function.
+// Returns the global frame, creating it if needed. The
+// global frame lives as long as the evaluator.
+template<typename P>
+Store&
+Basic_evaluator<P>::globals()
+{
+  if (stack.empty()) {
+    ++pushed_frames;
+    stack.push();
+  }
+  return stack.bottom();
+}
+
+
+// Returns the remaining heap, in bytes. Values created
+// outside the evaluator, for example by restoring a
+// snapshot, take their memory from here.
+template<typename P>
+std::size_t&
+Basic_evaluator<P>::free_heap()
+{
+  return heap;
+}
+
+
+// Evaluate the top-level declarations of the module in
+// the global frame. Declarations that are already bound,
+// for example by restoring a snapshot, are skipped.
+template<typename P>
+void
+Basic_evaluator<P>::init(Module_decl const* m)
+{
+  Store& g = globals();
+  for (Decl const* d : m->declarations()) {
+    if (!g.lookup(d->name()))
+      eval(d);
+  }
+}
+
+
+// Execute the given function. The top-level declarations
+// of its module are evaluated first, in order to establish
+// the evaluation context.
 //
 // TODO: What if there are operands?
+template<typename P>
 Value
-Evaluator::exec(Function_decl const* fn)
+Basic_evaluator<P>::exec(Function_decl const* fn)
 {
-  // Evaluate all of the top-level declarations in
-  // order to re-establish the evaluation context.
-  Store_sentinel store(*this);
-  Module_decl const* m = cast<Module_decl>(fn->context());
-  for (Decl const* d : m->declarations())
-    eval(d);
+  init(cast<Module_decl>(fn->context()));
 
   // TODO: Check the result code.
+  Call_sentinel call(*this, fn, fn);
   Value result;
   Control ctl = eval(fn->body(), result);
   if (ctl != return_ctl)
     throw std::runtime_error("function error");
-
   return result;
 }
+
+
+// -------------------------------------------------------------------------- //
+// Profiling policy
+
+namespace
+{
+
+// Returns the current time in seconds.
+inline double
+now()
+{
+  using Clock = std::chrono::steady_clock;
+  std::chrono::duration<double> d = Clock::now().time_since_epoch();
+  return d.count();
+}
+
+} // namespace
+
+
+void
+Profiling_policy::on_call(Function_decl const* f)
+{
+  ++fns[f].calls;
+  starts.push_back(now());
+}
+
+
+// Note that recursive calls are accumulated into the
+// same entry, so inclusive times may exceed the total
+// running time of the program.
+void
+Profiling_policy::on_return(Function_decl const* f)
+{
+  fns[f].time += now() - starts.back();
+  starts.pop_back();
+}
+
+
+// Print the profile, listing functions in decreasing
+// order of inclusive time.
+void
+Profiling_policy::report(std::ostream& os) const
+{
+  using Entry = std::pair<Function_decl const*, Function_profile>;
+  std::vector<Entry> v(fns.begin(), fns.end());
+  std::sort(v.begin(), v.end(), [](Entry const& a, Entry const& b) {
+    return a.second.time > b.second.time;
+  });
+
+  os << "statements: " << stmts << '\n';
+  os << "objects: " << allocs << '\n';
+  for (Entry const& e : v) {
+    os << e.first->name()->spelling() << ": "
+       << e.second.calls << " calls, "
+       << e.second.time << "s\n";
+  }
+}
+
+
+// -------------------------------------------------------------------------- //
+// Tracing policy
+
+namespace
+{
+
+// Returns the name of the statement's kind.
+char const*
+stmt_name(Stmt const* s)
+{
+  struct Fn
+  {
+    char const* operator()(Empty_stmt const*) { return "empty"; }
+    char const* operator()(Block_stmt const*) { return "block"; }
+    char const* operator()(Assign_stmt const*) { return "assign"; }
+    char const* operator()(Return_stmt const*) { return "return"; }
+    char const* operator()(If_then_stmt const*) { return "if-then"; }
+    char const* operator()(If_else_stmt const*) { return "if-else"; }
+    char const* operator()(While_stmt const*) { return "while"; }
+    char const* operator()(Break_stmt const*) { return "break"; }
+    char const* operator()(Continue_stmt const*) { return "continue"; }
+    char const* operator()(Expression_stmt const*) { return "expression"; }
+    char const* operator()(Declaration_stmt const*) { return "declaration"; }
+  };
+  return apply(s, Fn{});
+}
+
+} // namespace
+
+
+Tracing_policy::Tracing_policy()
+  : os(&std::cerr), depth(0)
+{ }
+
+
+std::ostream&
+Tracing_policy::indent()
+{
+  for (int i = 0; i < depth; ++i)
+    *os << "  ";
+  return *os;
+}
+
+
+void
+Tracing_policy::on_call(Function_decl const* f)
+{
+  indent() << "call " << f->name()->spelling() << '\n';
+  ++depth;
+}
+
+
+void
+Tracing_policy::on_return(Function_decl const* f)
+{
+  --depth;
+  indent() << "return " << f->name()->spelling() << '\n';
+}
+
+
+void
+Tracing_policy::on_stmt(Stmt const* s)
+{
+  indent() << stmt_name(s) << '\n';
+}
+
+
+void
+Tracing_policy::on_alloc(Type const* t)
+{
+  indent() << "alloc " << *t << '\n';
+}
+
+
+// -------------------------------------------------------------------------- //
+// Call tracing policy
+
+void
+Call_tracing_policy::on_call(Function_decl const*)
+{
+  starts.push_back(trace_log().now());
+}
+
+
+void
+Call_tracing_policy::on_return(Function_decl const* f)
+{
+  double t = starts.back();
+  starts.pop_back();
+  trace_log().add("call", f->name()->spelling().c_str(), t, trace_log().now() - t);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Instantiation
+
+template class Basic_evaluator<Fast_policy>;
+template class Basic_evaluator<Profiling_policy>;
+template class Basic_evaluator<Tracing_policy>;
+template class Basic_evaluator<Call_tracing_policy>;
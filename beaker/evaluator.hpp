@@ -8,6 +8,10 @@
 #include "prelude.hpp"
 #include "value.hpp"
 #include "environment.hpp"
+#include "location.hpp"
+
+#include <iosfwd>
+#include <unordered_map>
 
 
 // Dynamic binding of symbols to their values.
@@ -36,12 +40,164 @@ enum Control
 };
 
 
+// -------------------------------------------------------------------------- //
+// Evaluation policies
+//
+// An evaluation policy receives notifications from the
+// evaluator at interesting points during interpretation:
+//
+//    - on_call and on_return bracket each function call,
+//    - on_stmt precedes the evaluation of each statement, and
+//    - on_alloc precedes the creation of each object.
+//
+// The evaluator is parameterized by its policy, so the hooks
+// of the default policy are empty inline functions that compile
+// away entirely. Instrumentation only costs something when a
+// different policy is chosen.
+
+
+// The default policy does nothing.
+struct Fast_policy
+{
+  void on_call(Function_decl const*) { }
+  void on_return(Function_decl const*) { }
+  void on_stmt(Stmt const*) { }
+  void on_alloc(Type const*) { }
+
+  void report(std::ostream&) const { }
+};
+
+
+// The profiling policy counts statements and objects, and
+// accumulates the number of calls and the inclusive time
+// spent in each function.
+struct Profiling_policy
+{
+  struct Function_profile
+  {
+    std::size_t calls = 0;
+    double      time = 0;  // Inclusive time, in seconds
+  };
+
+  void on_call(Function_decl const*);
+  void on_return(Function_decl const*);
+  void on_stmt(Stmt const*) { ++stmts; }
+  void on_alloc(Type const*) { ++allocs; }
+
+  void report(std::ostream&) const;
+
+  std::unordered_map<Function_decl const*, Function_profile> fns;
+  std::vector<double> starts; // Start times of active calls
+  std::size_t stmts = 0;
+  std::size_t allocs = 0;
+};
+
+
+// The tracing policy writes a line to the trace stream for
+// every call, return, statement, and allocation. Lines are
+// indented by the current call depth.
+struct Tracing_policy
+{
+  Tracing_policy();
+
+  void on_call(Function_decl const*);
+  void on_return(Function_decl const*);
+  void on_stmt(Stmt const*);
+  void on_alloc(Type const*);
+
+  void report(std::ostream&) const { }
+
+  std::ostream& indent();
+
+  std::ostream* os;
+  int           depth;
+};
+
+
+// The call tracing policy records a span in the trace log
+// for each function call. See trace.hpp.
+struct Call_tracing_policy
+{
+  void on_call(Function_decl const*);
+  void on_return(Function_decl const*);
+  void on_stmt(Stmt const*) { }
+  void on_alloc(Type const*) { }
+
+  void report(std::ostream&) const { }
+
+  std::vector<double> starts; // Start times of active calls
+};
+
+
+// -------------------------------------------------------------------------- //
+// Resource limits
+//
+// The limits bound the resources that an interpreted program
+// may consume:
+//
+//    - fuel is spent by each call and each iteration of a
+//      loop, bounding the running time of the program,
+//    - heap bounds the bytes allocated for objects, and
+//    - depth bounds the number of active calls.
+//
+// A limit of 0 is unbounded. A program that exceeds a limit
+// fails with an Evaluation_error. If the evaluator is given
+// the locations of the program, exhausting the fuel or the
+// depth is diagnosed at the call or loop that did so.
+//
+// The evaluator counts each resource down from its limit, so
+// a check is a single decrement and test. An unbounded limit
+// starts at the maximum count and is never exhausted.
+struct Limits
+{
+  std::size_t fuel = 0;
+  std::size_t heap = 0;
+  std::size_t depth = 0;
+};
+
+
+[[noreturn]] void limit_exceeded(char const*);
+[[noreturn]] void limit_exceeded(Location, char const*);
+
+
+// -------------------------------------------------------------------------- //
+// Preemption
+//
+// An evaluator can be given a time slice, measured in fuel.
+// Whenever the slice is spent, the evaluator calls its yield
+// function, which may suspend the evaluation (see
+// scheduler.hpp), and then starts a new slice.
+//
+// The fuel counter holds only the current slice, with the
+// remainder of the fuel held in reserve. Preemption is thus
+// checked by the same test that checks the fuel limit, and
+// costs nothing until the slice is spent.
+struct Yield
+{
+  virtual ~Yield() { }
+  virtual void operator()() = 0;
+};
+
+
+// -------------------------------------------------------------------------- //
+// Evaluator
+
 // The evaluator is responsible for the interpretation
-// of a program as a value.
-class Evaluator
+// of a program as a value. The policy P is notified of
+// calls, statements, and allocations as they occur.
+//
+// Note that the evaluator is explicitly instantiated for
+// each policy in evaluator.cpp.
+template<typename P>
+class Basic_evaluator
 {
   struct Store_sentinel;
+  struct Call_sentinel;
 public:
+  using Policy = P;
+
+  Basic_evaluator(Limits const& = Limits(), Location_map const* = nullptr);
+
   Value eval(Expr const*);
   Value eval(Literal_expr const*);
   Value eval(Id_expr const*);
@@ -90,19 +246,44 @@ public:
   Control eval(Expression_stmt const*, Value&);
   Control eval(Declaration_stmt const*, Value&);
 
-  Value exec(Function_decl const*);
+  Store&       globals();
+  std::size_t& free_heap();
+  void         init(Module_decl const*);
+  Value        exec(Function_decl const*);
+
+  void preempt(std::size_t, Yield&);
+
+  P policy;
 
 private:
+  void burn(void const*);
+  void refuel(void const*);
+
+  Location locate(void const*) const;
+
   Store_stack stack;
+  std::size_t fuel;         // Remaining fuel in this slice
+  std::size_t heap;         // Remaining heap bytes
+  std::size_t depth;        // Remaining calls
+  std::size_t reserve = 0;  // Remaining fuel after this slice
+  std::size_t slice = 0;    // Fuel per slice
+  Yield*      yield = nullptr;
+
+  Location_map const* locs; // Source locations, if any
 };
 
 
+extern Counter pushed_frames;
+
+
 // A helper class for managing stack frames.
-struct Evaluator::Store_sentinel
+template<typename P>
+struct Basic_evaluator<P>::Store_sentinel
 {
-  Store_sentinel(Evaluator& e)
+  Store_sentinel(Basic_evaluator& e)
     : eval(e)
   {
+    ++pushed_frames;
     eval.stack.push();
   }
 
@@ -111,10 +292,52 @@ struct Evaluator::Store_sentinel
     eval.stack.pop();
   }
 
-  Evaluator& eval;
+  Basic_evaluator& eval;
 };
 
 
+// A helper class for bounding the depth of calls and
+// notifying the policy of the call of f. The policy is
+// notified of the return even if the call fails. The
+// call site is the node diagnosed if the depth is
+// exceeded.
+template<typename P>
+struct Basic_evaluator<P>::Call_sentinel
+{
+  Call_sentinel(Basic_evaluator& e, Function_decl const* f, void const* site)
+    : eval(e), fn(f)
+  {
+    if (eval.depth == 0)
+      limit_exceeded(eval.locate(site), "call depth limit exceeded");
+    --eval.depth;
+    eval.policy.on_call(fn);
+  }
+
+  ~Call_sentinel()
+  {
+    eval.policy.on_return(fn);
+    ++eval.depth;
+  }
+
+  Basic_evaluator&     eval;
+  Function_decl const* fn;
+};
+
+
+// The evaluators provided by the interpreter. The fast
+// evaluator is used for all compile-time evaluation.
+using Evaluator = Basic_evaluator<Fast_policy>;
+using Profiling_evaluator = Basic_evaluator<Profiling_policy>;
+using Tracing_evaluator = Basic_evaluator<Tracing_policy>;
+using Call_tracing_evaluator = Basic_evaluator<Call_tracing_policy>;
+
+
+extern template class Basic_evaluator<Fast_policy>;
+extern template class Basic_evaluator<Profiling_policy>;
+extern template class Basic_evaluator<Tracing_policy>;
+extern template class Basic_evaluator<Call_tracing_policy>;
+
+
 // -------------------------------------------------------------------------- //
 // Expression evaluation
 
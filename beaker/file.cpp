@@ -4,6 +4,19 @@
 #include "file.hpp"
 
 
+// The path of a regular file is made canonical. Other
+// paths (e.g., /dev/stdin for a pipe) are kept as given,
+// since they may not resolve to a name that can be opened.
+// Throws a filesystem_error if the file does not exist.
 File::File(char const* p)
-  : path_(boost::filesystem::canonical(p))
-{ }
+  : path_(p)
+{
+  namespace errc = boost::system::errc;
+  if (!boost::filesystem::exists(path_))
+    throw boost::filesystem::filesystem_error("cannot open input file", path_,
+      errc::make_error_code(errc::no_such_file_or_directory));
+  boost::system::error_code ec;
+  Path c = boost::filesystem::canonical(path_, ec);
+  if (!ec && boost::filesystem::is_regular_file(c, ec))
+    path_ = c;
+}
@@ -5,6 +5,8 @@
 #include "stmt.hpp"
 #include "decl.hpp"
 #include "evaluator.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
 
 #include "llvm/IR/Type.h"
 #include "llvm/IR/GlobalVariable.h"
@@ -49,6 +51,7 @@ Generator::get_name(Decl const* d)
 llvm::Type*
 Generator::get_type(Type const* t)
 {
+  Timer_sentinel timer(lowering_time);
   struct Fn
   {
     Generator& g;
@@ -832,6 +835,7 @@ Generator::gen(Variable_decl const* d)
 void
 Generator::gen(Function_decl const* d)
 {
+  Cost_sentinel cost(generation_cost, d);
   String name = get_name(d);
   llvm::Type* type = get_type(d->type());
 
@@ -973,19 +977,29 @@ Generator::gen(Module_decl const* d)
   mod = new llvm::Module("a.ll", cxt);
 
   // Generate all top-level declarations.
-  for (Decl const* d1 : d->declarations())
+  for (Decl const* d1 : d->declarations()) {
+    Trace_span span("generate", d1->name()->spelling().c_str());
     gen(d1);
+  }
 
   // TODO: Make a second pass to generate global
   // constructors for initializers.
 }
 
 
+Counter emitted_instructions("llvm.instructions", "LLVM instructions emitted");
+
+
 llvm::Module*
 Generator::operator()(Decl const* d)
 {
   assert(is<Module_decl>(d));
   gen(d);
+
+  for (llvm::Function const& f : *mod)
+    for (llvm::BasicBlock const& b : f)
+      emitted_instructions += b.size();
+
   return mod;
 }
 
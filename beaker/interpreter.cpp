@@ -4,12 +4,19 @@
 #include "lexer.hpp"
 #include "parser.hpp"
 #include "elaborator.hpp"
+#include "decl.hpp"
 #include "evaluator.hpp"
 #include "generator.hpp"
 #include "error.hpp"
+#include "options.hpp"
+#include "phase.hpp"
+#include "stats.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <memory>
 
 #include <llvm/IR/Module.h>
 #include <llvm/Support/raw_ostream.h>
@@ -18,41 +25,147 @@
 using namespace std;
 
 
+// Returns the evaluation limits selected by the options.
+Limits
+limits(Options const& opts)
+{
+  Limits lim;
+  lim.fuel = opts.fuel;
+  lim.heap = opts.heap;
+  lim.depth = opts.depth;
+  return lim;
+}
+
+
+// Restore the global variables of the program from the
+// snapshot at path. If the snapshot is missing or out of
+// date, initialize the variables and take a new snapshot.
+template<typename E>
+void
+restore(E& ev, char const* path, File const& src, Function_decl const* main)
+{
+  Module_decl const* m = cast<Module_decl>(main->context());
+  if (!read_snapshot(path, src, m, ev.globals(), ev.free_heap())) {
+    ev.init(m);
+    write_snapshot(path, src, m, ev.globals());
+  }
+}
+
+
+// Print the result of the program and the report of the
+// evaluator's policy.
+template<typename E>
+void
+report(E& ev, Value const& v)
+{
+  std::cout << "result: " << v << '\n';
+  ev.policy.report(std::cerr);
+}
+
+
+// Execute the program using an evaluator instantiated
+// over the selected policy and bounded by the limits.
+// Policy reports are written to the standard error stream.
+// Exceeded limits are diagnosed at the locations in locs.
+//
+// The global variables are initialized, or restored from a
+// snapshot, before main is run. In server mode, this is done
+// once by the server, so that each request only runs main,
+// in a child forked from the server (see server.hpp). Returns
+// false if the server fails.
+template<typename E>
+bool
+run(Options const& opts, File const& src, Location_map const& locs, Function_decl const* main)
+{
+  E ev(limits(opts), &locs);
+  Phase_sentinel phase(evaluation_time);
+  if (opts.snapshot)
+    restore(ev, opts.snapshot, src, main);
+  else
+    ev.init(cast<Module_decl>(main->context()));
+  if (opts.server) {
+    phase.stop();
+    auto fn = [&]() { report(ev, ev.exec(main)); };
+    return serve(opts.server, opts.server_jobs, fn);
+  }
+  Value v = ev.exec(main);
+  phase.stop();
+  report(ev, v);
+  return true;
+}
+
+
+// Execute the program under the selected policy.
+bool
+execute(Options const& opts, File const& src, Location_map const& locs, Function_decl const* main)
+{
+  switch (opts.eval) {
+    case fast_eval: return run<Evaluator>(opts, src, locs, main);
+    case profile_eval: return run<Profiling_evaluator>(opts, src, locs, main);
+    case trace_eval: return run<Tracing_evaluator>(opts, src, locs, main);
+    case trace_calls_eval: return run<Call_tracing_evaluator>(opts, src, locs, main);
+  }
+  return false;
+}
+
+
 int
 main(int argc, char* argv[])
 {
-  // Prepare the symbol table.
-  Symbol_table syms;
-  init_symbols(syms);
+  Options opts;
+  if (!parse_options(opts, argc, argv))
+    return -1;
+  if (opts.time)
+    time_report().enable();
+  if (opts.mem)
+    memory_report().enable();
+  if (opts.trace)
+    trace_log().enable(opts.trace);
+
+  // Prepare the symbol table. The threads that lex in
+  // parallel intern symbols in a concurrent table.
+  Symbol_table table;
+  std::unique_ptr<Concurrent_symbol_table> shared;
+  if (opts.lex_threads > 1)
+    shared.reset(new Concurrent_symbol_table);
+  Symbol_table_ref syms = shared ? Symbol_table_ref(*shared) : Symbol_table_ref(table);
 
   // Prepare the input buffer.
-  File src = argv[1];
-  Input_buffer in = src;
+  File src = opts.input;
+  Input_buffer in(src);
 
   try {
-    // Create the token stream over. This will be populated
-    // by the lexer.
-    Token_stream ts;
-
-    // Build and run the lexer.
-    Lexer lex(syms, in);
-    if (!lex.lex(ts))
+    // Create the token stream. This is populated by the
+    // lexer, either all at once or, when lexing lazily, as
+    // the parser requests tokens. In the latter case, lexing
+    // time is included in the parsing time.
+    Phase_sentinel lex_phase(lexing_time);
+    Literal_pool lits;
+    Lexer lex(syms, lits, in);
+    Token_stream ts(opts.lazy_lex ? &lex : nullptr);
+    if (!opts.lazy_lex && !lex.lex(ts, opts.lex_threads, opts.lex_chunk))
       return -1;
+    lex_phase.stop();
 
     // Build and run the parser. The location map
     // is used to save source locations, which are
     // used to diagnose elaboration errors.
+    Phase_sentinel parse_phase(parsing_time);
     Location_map locs;
-    Parser parse(syms, ts, locs);
+    Parser parse(syms, lits, ts, locs);
     Decl* m = parse.module();
-    if (!parse)
+    if (!parse || lex.failed())
       return -1;
+    lits.clear();  // Literals are not needed after parsing
+    parse_phase.stop();
 
     // Perform semantic analysis.
     //
     // TODO: Implement a parse-only phase.
+    Phase_sentinel elab_phase(elaboration_time);
     Elaborator elab(locs);
     elab.elaborate(m);
+    elab_phase.stop();
 
     // Find an entry point for evaluation.
     //
@@ -61,13 +174,15 @@ main(int argc, char* argv[])
     // are evaluated prior to entering main.
     //
     // TODO: Actually pass command line arguments to main.
-    if (elab.main) {
-      Evaluator ev;
-      Value v = ev.exec(elab.main);
-      std::cout << "result: " << v << '\n';
-    } else {
+    //
+    // In server mode, the program is run once for each
+    // request, in a child process. See server.hpp.
+    if (!elab.main)
       std::cout << "no main\n";
-    }
+    else if (opts.server)
+      return execute(opts, src, locs, elab.main) ? 0 : -1;
+    else
+      execute(opts, src, locs, elab.main);
   }
 
   // Diagnose uncaught translation errors and exit
@@ -80,5 +195,16 @@ main(int argc, char* argv[])
     return -1;
   }
 
+  if (opts.time)
+    time_report().print(std::cerr);
+  if (opts.mem)
+    memory_report().print(std::cerr);
+  if (opts.stats == table_stats)
+    stats().print(std::cerr);
+  else if (opts.stats == json_stats)
+    stats().print_json(std::cerr);
+  if (opts.trace && !trace_log().write())
+    return -1;
+
   // FIXME: Do something with the module.
 }
@@ -3,44 +3,36 @@
 
 #include "lexer.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <thread>
 
 
 // -------------------------------------------------------------------------- //
 // Input buffer
 
+// Map the file into memory, or read it if it cannot be
+// mapped (e.g., if it is a pipe). Token and line positions
+// refer directly to the mapping.
 Input_buffer::Input_buffer(File const& f)
-  : file_(&f)
+  : file_(&f), view_(false)
 {
-  std::ifstream is(f.path().c_str());
-  buf_.assign(is);
-  pos_ = buf_.begin();
-  last_ = pos_;
-}
-
-
-
-// Returns the current character and advances the
-// stream.
-char
-Input_buffer::get()
-{
-  if (eof())
-    return 0;
-
-  if (*pos_ == '\n') {
-    lines_.emplace(offset(), Line(lines_.size() + 1, last_, pos_));
-    last_ = pos_ + 1;
+  if (!buf_.map(f.path().c_str())) {
+    std::ifstream is(f.path().c_str());
+    buf_.assign(is);
   }
-
-  return *pos_++;
+  pos_ = buf_.begin();
+  base_ = source_map().add(file_, buf_.begin(), buf_.end());
 }
 
 
 // -------------------------------------------------------------------------- //
 // Lexer
 
+Counter lexed_tokens("lexer.tokens", "tokens lexed");
+
+
 // Returns the next token in the character stream.
 // If no next token can be identified, an error
 // is emitted and we return the error token.
@@ -55,6 +47,7 @@ Lexer::scan()
     // Update the position of the current source location.
     // This denotes the beginning of the current token.
     loc_ = in_.location();
+    first_ = in_.position();
 
     switch (peek()) {
       case 0: return eof();
@@ -118,10 +111,50 @@ Lexer::scan()
 }
 
 
+namespace
+{
+
+// Returns true if c can follow a backslash in a character or
+// string literal.
+inline bool
+is_escape(char c)
+{
+  switch (c) {
+    case '\'': case '\"': case '\\':
+    case 'a': case 'b': case 'f': case 'n':
+    case 't': case 'r': case 'v':
+      return true;
+  }
+  return false;
+}
+
+
+// Translate a character from the basic character
+// set into the execution character set.
+inline char
+translate_escape(char c)
+{
+  switch (c) {
+    case '\'': return '\'';
+    case '\"': return '\"';
+    case '\\': return '\\';
+    case 'a': return '\a';
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case 'v': return '\v';
+  }
+  throw std::runtime_error("invalid escape sequence");
+}
+
+} // namespace
+
+
 // character ::= ' c '
 //
-// TODO: Allow for unicode characters? Imrove error
-// handling.
+// TODO: Allow for unicode characters?
 //
 // FIXME: Move the diagnostics into the semantic
 // action for character tokens. We might actually
@@ -131,27 +164,42 @@ Lexer::character()
 {
   assert(peek() == '\'');
   get(); // '
-  if (peek() == '\\') // consume an escape.
+  bool escape = peek() == '\\';
+  if (escape) // consume an escape.
     get();
-  get(); // c
+  char c = get(); // c
   if (peek() != '\'')
-    throw std::runtime_error("invalid character literal");
+    return error("invalid character literal");
   get(); // '
+  if (escape && !is_escape(c))
+    return error("invalid escape sequence");
   return on_character();
 }
 
 
+// string ::= " c* "
+//
+// An invalid escape sequence is diagnosed after the
+// whole literal has been scanned, so that lexing resumes
+// after the literal.
 Token
 Lexer::string()
 {
   assert(peek() == '"');
   get();
+  bool valid = true;
   while (peek() != '"') {
-    if (peek() == '\\')
+    if (peek() == '\\') {
       get();
+      valid &= is_escape(peek());
+    }
+    if (in_.eof())
+      return error("unterminated string literal");
     get();
   }
   get();
+  if (!valid)
+    return error("invalid escape sequence");
   return on_string();
 }
 
@@ -162,7 +210,7 @@ Lexer::string()
 inline Token
 Lexer::on_token()
 {
-  Symbol const* sym = syms_.get(build_.take());
+  Symbol const* sym = syms_.get(lexeme());
   return Token(loc_, sym->token(), sym);
 }
 
@@ -171,7 +219,7 @@ Lexer::on_token()
 inline Token
 Lexer::on_word()
 {
-  String str = build_.take();
+  String_ref str = lexeme();
 
   // Try looking up the symbol first. If there is no such
   // symbol, then this must be an identifier.
@@ -187,43 +235,16 @@ Lexer::on_word()
 inline Token
 Lexer::on_integer()
 {
-  String str = build_.take();
-  int n = string_to_int<int>(str, 10);
-  Symbol* sym = syms_.put<Integer_sym>(str, integer_tok, n);
-  return Token(loc_, integer_tok, sym);
-}
-
-
-namespace
-{
-
-// Translate a character from the basic character
-// set into the execution character set.
-inline char
-translate_escape(char c)
-{
-  switch (c) {
-    case '\'': return '\'';
-    case '\"': return '\"';
-    case '\\': return '\\';
-    case 'a': return '\a';
-    case 'b': return '\b';
-    case 'f': return '\f';
-    case 'n': return '\n';
-    case 't': return '\t';
-    case 'r': return '\r';
-    case 'v': return '\v';
-  }
-  throw std::runtime_error("invalid escape sequence");
+  String_ref str = lexeme();
+  int n = string_to_int<int>(str.begin(), str.end(), 10);
+  return Token(loc_, integer_tok, lits_.put_integer(n));
 }
 
-} // namespace
-
 
 Token
 Lexer::on_character()
 {
-  String str = build_.take();
+  String_ref str = lexeme();
 
   // Translate the spelling of the lexeme in the
   // basic character set into the execution character
@@ -233,27 +254,26 @@ Lexer::on_character()
   // in order to better enable translation between
   // the basic and execution character sets.
   int rep;
-  char const* p = str.c_str();
+  char const* p = str.data();
   if (*++p == '\\')
-    rep = *p;
-  else
     rep = translate_escape(*++p);
-  Symbol* sym = syms_.put<Character_sym>(str, character_tok, rep);
+  else
+    rep = *p;
 
-  return Token(loc_, character_tok, sym);
+  return Token(loc_, character_tok, std::uint32_t((unsigned char)rep));
 }
 
 
 Token
 Lexer::on_string()
 {
-  String str = build_.take();
+  String_ref str = lexeme();
 
   // Translate the spelling of the lexeme ion the basic
   // character set into the execution character set.
   String rep;
   rep.reserve(str.size());
-  char const* p = str.c_str() + 1;
+  char const* p = str.data() + 1;
   while (*p != '\"') {
     if (*p != '\\')
       rep.push_back(*p);
@@ -261,9 +281,8 @@ Lexer::on_string()
       rep.push_back(translate_escape(*++p));
     ++p;
   }
-  Symbol* sym = syms_.put<String_sym>(str, string_tok, rep);
 
-  return Token(loc_, string_tok, sym);
+  return Token(loc_, string_tok, lits_.put_string(std::move(rep)));
 }
 
 
@@ -271,16 +290,10 @@ void
 Lexer::comment()
 {
   get();
-  while (true) {
-    char c = peek();
-    if (!c || is_newline(c))
-      break;
-    get();
-  }
+  in_.advance(scan_line(in_.position(), in_.end()));
 
   // TODO: Do something interesting with comments
   // instead of just discarding them.
-  build_.clear();
 }
 
 
@@ -292,15 +305,7 @@ Lexer::comment()
 void
 Lexer::space()
 {
-  while (true) {
-    char c = peek();
-    if (is_space(c))
-      ignore();
-    else if (is_newline(c))
-      ignore();
-    else
-      break;
-  }
+  in_.advance(scan_whitespace(in_.position(), in_.end()));
 }
 
 
@@ -312,13 +317,179 @@ Lexer::error()
 {
   state_ |= error_flag;
 
-  // Actually save the character into the accumulator
-  // so we can diagnose exactly what the invalid symbol
-  // was.
+  // Consume the character so we can diagnose exactly
+  // what the invalid symbol was.
   get();
 
   // TODO: Improve diagnostics.
-  std::cerr << "error:" << loc_ << ": invalid symbol '" << build_.take() << "'\n";
+  if (!(state_ & quiet_flag))
+    std::cerr << "error:" << loc_ << ": invalid symbol '" << lexeme() << "'\n";
 
   return Token();
 }
+
+
+// Set the error flag and return an invalid token. The
+// characters of the current token have been consumed, and
+// the message describes why they are not a valid token.
+Token
+Lexer::error(char const* msg)
+{
+  state_ |= error_flag;
+  if (!(state_ & quiet_flag))
+    std::cerr << "error:" << loc_ << ": " << msg << '\n';
+  return Token();
+}
+
+
+// -------------------------------------------------------------------------- //
+// Parallel lexing
+
+namespace
+{
+
+// A chunk of the input, lexed by its own thread. The chunk
+// owns the tokens that start in [first, last), although its
+// last token may extend past last. Symbols are interned in
+// the shared concurrent table, and literals added to the
+// chunk's own pool. The pool is not counted, since the
+// literals used are counted again when they are copied.
+struct Chunk
+{
+  char const*        first;
+  char const*        last;
+  char const*        stop;  // The end of the last token lexed
+  std::vector<Token> toks;
+  Literal_pool       lits{false};
+};
+
+
+// Lex the tokens of the chunk c of the buffer b, interning
+// symbols in syms. This stops at the first token not owned
+// by the chunk, or at the first error. Errors are not
+// diagnosed here, since the chunk may not start where a
+// token starts (e.g., in a string literal). The input
+// following stop is lexed again serially, and that
+// diagnoses any real errors.
+void
+lex_chunk(Concurrent_symbol_table& syms, Input_buffer const& b, Chunk& c)
+{
+  Input_buffer in(b, c.first);
+  Lexer lex(syms, c.lits, in, Lexer::quiet_flag);
+  std::uint32_t last = in.location(c.last).offset();
+  c.stop = c.first;
+  try {
+    while (true) {
+      Token tok = lex.scan();
+      if (!tok || tok.location().offset() >= last)
+        return;
+      c.toks.push_back(tok);
+      c.stop = in.position();
+    }
+  } catch (std::exception&) {
+    // The input following stop will be lexed again.
+  }
+}
+
+
+// Returns the literal token tok, whose value is in the
+// pool c, with its value copied to lits.
+Token
+copy_literal(Literal_pool& lits, Literal_pool const& c, Token tok)
+{
+  switch (tok.kind()) {
+    case integer_tok:
+      return Token(tok.location(), integer_tok, lits.put_integer(tok.integer_value(c)));
+    case string_tok:
+      return Token(tok.location(), string_tok, lits.put_string(String(tok.string_value(c))));
+    default:
+      return tok;
+  }
+}
+
+} // namespace
+
+
+// Lexically analyze the character stream using up to n
+// threads, each lexing a chunk of at least m bytes, or of
+// min_chunk bytes if m is 0. The result is the same as that
+// of lex. The threads intern symbols in the same table, so
+// this requires a concurrent symbol table; otherwise the
+// stream is lexed serially.
+//
+// The input is split into chunks at newlines, and each
+// chunk is lexed by a separate thread. A chunk can start
+// in the middle of a token, but only of a string literal,
+// since comments and all other tokens end at a newline.
+// The chunks are then joined by lexing serially until the
+// serial lexer produces a token that starts where one of
+// the chunk's tokens starts. The tokens of the chunk
+// from there on are the same as those the serial lexer
+// would produce, so they are taken as they are, and
+// serial lexing resumes at the end of the chunk.
+//
+// Since the threads share the symbol table, the tokens of
+// a chunk refer to the same symbols as those of the serial
+// lexer, and only their literals need to be copied into the
+// pool. Symbols are numbered in the order that the threads
+// intern them, rather than in the order of the input. A
+// chunk that starts in a string literal may intern symbols
+// that do not occur outside of that literal.
+bool
+Lexer::lex(Token_stream& ts, std::size_t n, std::size_t m)
+{
+  Concurrent_symbol_table* syms = syms_.concurrent();
+  std::size_t size = in_.end() - in_.position();
+  n = std::min(n, size / (m ? m : min_chunk));
+  if (n < 2 || !syms)
+    return lex(ts);
+
+  std::vector<Chunk> chunks(n);
+  char const* p = in_.position();
+  for (std::size_t i = 0; i < n; ++i) {
+    chunks[i].first = p;
+    if (i + 1 < n) {
+      p = std::max(p, in_.position() + (i + 1) * size / n);
+      p = std::find(p, in_.end(), '\n');
+      if (p != in_.end())
+        ++p;
+    } else {
+      p = in_.end();
+    }
+    chunks[i].last = p;
+  }
+
+  std::vector<std::thread> pool;
+  for (std::size_t i = 1; i < n; ++i)
+    pool.emplace_back(lex_chunk, std::ref(*syms), std::cref(in_), std::ref(chunks[i]));
+  lex_chunk(*syms, in_, chunks[0]);
+  for (std::thread& t : pool)
+    t.join();
+
+  std::size_t i = 0;
+  while (!done()) {
+    // Skip the chunks that end before the current position.
+    while (i < n && chunks[i].stop <= in_.position())
+      ++i;
+
+    if (!scan(ts) || i == n)
+      continue;
+
+    // If the chunk has a token where the serial lexer
+    // produced one, take the rest of the chunk's tokens.
+    Chunk& c = chunks[i];
+    std::uint32_t off = loc_.offset();
+    auto iter = std::lower_bound(c.toks.begin(), c.toks.end(), off, [](Token const& t, std::uint32_t n) {
+      return t.location().offset() < n;
+    });
+    if (iter == c.toks.end() || iter->location().offset() != off)
+      continue;
+    for (++iter; iter != c.toks.end(); ++iter) {
+      ts.put(iter->is_literal() ? copy_literal(lits_, c.lits, *iter) : *iter);
+      ++lexed_tokens;
+    }
+    in_.advance(c.stop);
+    ++i;
+  }
+  return !failed();
+}
@@ -6,7 +6,6 @@
 
 #include "string.hpp"
 #include "file.hpp"
-#include "line.hpp"
 #include "symbol.hpp"
 #include "token.hpp"
 
@@ -32,13 +31,12 @@
 // TODO: Allow the stream buffer to be shared by multiple
 // streams?
 //
-// TODO: The character stream produces a lexical view of
-// the input source (i.e., a mapping of character offsets
-// to lines). It would be nice if that view were separate
-// from the stream object so that it could be re-used by
-// various compiler components (e.g., diagnostics). Because
-// we don't do this now, the suorce location object is
-// fairly large and maintains the full source context.
+// The buffer is registered in the source map for its
+// lifetime, so a location is just an offset into the
+// buffer. The buffer does not track lines; the source map
+// finds them when a location is resolved (see location.hpp).
+// Because the source map refers to the buffer, it cannot
+// be copied or moved.
 class Input_buffer
 {
 public:
@@ -47,42 +45,72 @@ public:
   Input_buffer(String const&);
   Input_buffer(std::istream&);
   Input_buffer(File const&);
+  Input_buffer(Input_buffer const&, char const*);
+  ~Input_buffer();
+
+  Input_buffer(Input_buffer const&) = delete;
+  Input_buffer& operator=(Input_buffer const&) = delete;
 
   bool eof() const;
 
   char peek() const;
   char peek(int) const;
   char get();
+  void advance(Position);
 
   File const* file() const     { return file_; }
   Position    position() const { return pos_; }
+  Position    begin() const    { return buf_.begin(); }
+  Position    end() const      { return buf_.end(); }
   int         offset() const   { return pos_ - buf_.begin(); }
 
-  int         line_no() const;
-  int         column_no() const;
   Location    location() const;
+  Location    location(Position) const;
 
 private:
-  File const* file_;  // The file object, if any.
-  Stringbuf   buf_;   // The buffer.
-  Position    pos_;   // The current position.
-  Position    last_;  // Start of the current line.
-  Line_map    lines_; // Line offsets.
+  File const*   file_;  // The file object, if any.
+  Stringbuf     buf_;   // The buffer.
+  Position      pos_;   // The current position.
+  std::uint32_t base_;  // The location of the first character.
+  bool          view_;  // True if this is a view of another buffer.
 };
 
 
+// Initialize the buffer with a copy of the string. The
+// buffer is registered in the source map so that the
+// locations of its tokens can be resolved.
 inline
 Input_buffer::Input_buffer(String const& s)
-  : file_(nullptr), buf_(s), pos_(buf_.begin()), last_(pos_)
+  : file_(nullptr), buf_(s), pos_(buf_.begin()),
+    base_(source_map().add(nullptr, buf_.begin(), buf_.end())), view_(false)
 { }
 
 
 inline
 Input_buffer::Input_buffer(std::istream& is)
-  : file_(nullptr), buf_(is), pos_(buf_.begin()), last_(pos_)
+  : file_(nullptr), buf_(is), pos_(buf_.begin()),
+    base_(source_map().add(nullptr, buf_.begin(), buf_.end())), view_(false)
+{ }
+
+
+// Create a view of the buffer b, starting at the position
+// p. The view shares the characters and locations of b,
+// but has its own position. The view must not outlive b.
+inline
+Input_buffer::Input_buffer(Input_buffer const& b, char const* p)
+  : file_(b.file_), buf_(p, b.end()), pos_(p),
+    base_(b.base_ + (p - b.begin())), view_(true)
 { }
 
 
+inline
+Input_buffer::~Input_buffer()
+{
+  if (!view_)
+    source_map().remove(base_);
+}
+
+
 // Returns true if the stream is at the end
 // of the file.
 inline bool
@@ -103,19 +131,22 @@ Input_buffer::peek() const
 }
 
 
-// Returns the current line number.
-inline int
-Input_buffer::line_no() const
+// Returns the current character and advances the
+// stream.
+inline char
+Input_buffer::get()
 {
-  return lines_.size() + 1;
+  if (eof())
+    return 0;
+  return *pos_++;
 }
 
 
-// Returns the current column.
-inline int
-Input_buffer::column_no() const
+// Advance to the position p.
+inline void
+Input_buffer::advance(Position p)
 {
-  return position() - last_;
+  pos_ = p;
 }
 
 
@@ -123,7 +154,15 @@ Input_buffer::column_no() const
 inline Location
 Input_buffer::location() const
 {
-  return {file(), line_no(), column_no()};
+  return location(pos_);
+}
+
+
+// Returns the location of the position p.
+inline Location
+Input_buffer::location(Position p) const
+{
+  return Location(base_ + (p - buf_.begin()));
 }
 
 
@@ -131,25 +170,42 @@ Input_buffer::location() const
 // -------------------------------------------------------------------------- //
 // Lexer
 
+extern Counter lexed_tokens;
+
+
 // The lexer is responsible for the transformation
-// of a character stream into a list of tokens.
+// of a character stream into a list of tokens. The
+// lexer can scan the whole stream at once (see lex),
+// or act as the source of a token stream, scanning
+// each token when it is needed by the parser.
+//
+// Identifiers are interned in the symbol table. The values
+// of literals are added to the literal pool.
+//
 // FIXME: Maintain source code locations.
-class Lexer
+class Lexer : public Token_source
 {
 public:
   using State_flags = unsigned;
   static constexpr State_flags eof_flag   = 0x01;
   static constexpr State_flags error_flag = 0x02;
+  static constexpr State_flags quiet_flag = 0x04; // Don't diagnose errors
 
-  Lexer(Symbol_table&, Input_buffer&);
+  // Inputs are split into chunks of at least this many
+  // bytes for parallel lexing.
+  static constexpr std::size_t min_chunk = 1 << 16;
+
+  Lexer(Symbol_table_ref, Literal_pool&, Input_buffer&, State_flags = 0);
 
   // Lexer state
   bool done() const;
-  bool failed() const;
+  bool failed() const override;
 
   // Lexing
   bool lex(Token_stream&);
+  bool lex(Token_stream&, std::size_t, std::size_t = 0);
   bool scan(Token_stream&);
+  bool pull(Token_stream&) override;
 
   // Scanning
   Token scan();
@@ -182,6 +238,7 @@ public:
 
   Token eof();
   Token error();
+  Token error(char const*);
 
 private:
   // Semantic actions
@@ -192,11 +249,11 @@ private:
   Token on_string();
 
   // Lexing support
+  String_ref lexeme() const;
   char peek() const;
   char peek(int) const;
   char get();
   void get(int);
-  void ignore();
 
   // Token constructors
   Token symbol0();
@@ -208,17 +265,18 @@ private:
   void digit();
   void letter();
 
-  String_builder build_; // Cache characters during scan.
-  State_flags    state_; // The lexer's state
-  Symbol_table&  syms_;  // The symbol table
-  Input_buffer&  in_;    // The input buffer
-  Location       loc_;   // Start of the current token
+  State_flags            state_; // The lexer's state
+  Symbol_table_ref       syms_;  // The symbol table
+  Literal_pool&          lits_;  // The literal pool
+  Input_buffer&          in_;    // The input buffer
+  Location               loc_;   // Start of the current token
+  Input_buffer::Position first_; // First character of the current token
 };
 
 
 inline
-Lexer::Lexer(Symbol_table& s, Input_buffer& cs)
-  : build_(), state_(0), syms_(s), in_(cs)
+Lexer::Lexer(Symbol_table_ref s, Literal_pool& l, Input_buffer& cs, State_flags f)
+  : state_(f), syms_(s), lits_(l), in_(cs), first_(cs.position())
 { }
 
 
@@ -253,14 +311,37 @@ Lexer::lex(Token_stream& ts)
 
 
 // Put the next token into the token stream. Returns
-// true if scanning succeeded.
+// true if scanning succeeded. At the end of the input,
+// the stream is given the location of the end.
 inline bool
 Lexer::scan(Token_stream& ts)
 {
   if (Token tok = scan()) {
+    ++lexed_tokens;
     ts.put(tok);
     return true;
+  } else if (done()) {
+    ts.finish(tok);
+  }
+  return false;
+}
+
+
+// Put the next valid token into the token stream.
+// Returns false at the end of the character stream.
+//
+// After an invalid token, no more tokens are produced.
+// The rest of the input is lexed only to diagnose its
+// errors, as when lexing eagerly.
+inline bool
+Lexer::pull(Token_stream& ts)
+{
+  while (!done() && !failed()) {
+    if (scan(ts))
+      return true;
   }
+  while (!done())
+    scan();
   return false;
 }
 
@@ -476,10 +557,7 @@ inline Token
 Lexer::word()
 {
   assert(std::isalpha(peek()));
-  get();
-  while (std::isalpha(peek()) || std::isdigit(peek())) {
-    get();
-  }
+  in_.advance(scan_alnum(in_.position() + 1, in_.end()));
   return on_word();
 }
 
@@ -505,12 +583,22 @@ Lexer::digit()
 }
 
 
-// Set the eof flag and return an invalid token.
+// Set the eof flag and return an invalid token at the
+// end of the input.
 inline Token
 Lexer::eof()
 {
   state_ |= eof_flag;
-  return Token();
+  return Token(in_.location(), error_tok);
+}
+
+
+// Returns the characters of the current token, which
+// refer to the input buffer.
+inline String_ref
+Lexer::lexeme() const
+{
+  return String_ref(first_, in_.position() - first_);
 }
 
 
@@ -531,9 +619,7 @@ Lexer::peek(int n) const
 inline char
 Lexer::get()
 {
-  char c = in_.get();
-  build_.put(c);
-  return c;
+  return in_.get();
 }
 
 
@@ -541,19 +627,11 @@ inline void
 Lexer::get(int n)
 {
   while (n) {
-    char c = get();
+    get();
     --n;
-    build_.put(c);
   }
 }
 
 
-inline void
-Lexer::ignore()
-{
-  in_.get();
-}
-
-
 
 #endif
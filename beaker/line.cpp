@@ -2,3 +2,44 @@
 // All rights reserved
 
 #include "line.hpp"
+#include "string.hpp"
+
+#include <algorithm>
+
+
+// Build the line map of the buffer [first, last). With
+// vectors, newlines are found a vector at a time, and the
+// offset after each one is taken from the match mask.
+Line_map::Line_map(char const* first, char const* last)
+  : first_(first), last_(last), starts_(1, 0)
+{
+  char const* p = first;
+#if BEAKER_SCAN_VECTOR
+  constexpr int n = sizeof(Char_vector);
+  while (last - p >= n) {
+    unsigned m = mask(match_char(load_chars(p), '\n'));
+    while (m) {
+      starts_.push_back(p - first + __builtin_ctz(m) + 1);
+      m &= m - 1;
+    }
+    p += n;
+  }
+#endif
+  for (; p != last; ++p) {
+    if (is_newline(*p))
+      starts_.push_back(p - first + 1);
+  }
+}
+
+
+// Return the line in which the offset appears. Lines
+// are numbered from 1. The line does not include its
+// newline.
+Line
+Line_map::line(int n) const
+{
+  auto iter = std::upper_bound(starts_.begin(), starts_.end(), n);
+  int k = iter - starts_.begin();
+  char const* end = iter == starts_.end() ? last_ : first_ + *iter - 1;
+  return Line(k, first_ + starts_[k - 1], end);
+}
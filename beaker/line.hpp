@@ -4,7 +4,7 @@
 #ifndef BEAKER_LINE_HPP
 #define BEAKER_LINE_HPP
 
-#include <map>
+#include <vector>
 
 
 // A line is a view into a string buffer.
@@ -25,20 +25,20 @@ struct Line
 };
 
 
-// A line map associates the offset in a file
-// with its corresponding line.
-struct Line_map : std::map<int, Line>
+// A line map associates the offset in a buffer
+// with its corresponding line. The map is a sorted
+// vector of the offsets at which lines start, built
+// by a single scan of the buffer for newlines.
+struct Line_map
 {
-  Line const& line(int n) const;
-};
+  Line_map(char const*, char const*);
 
+  Line line(int n) const;
 
-// Return the line in which the offset appears.
-inline Line const& 
-Line_map::line(int n) const
-{
-  return (--upper_bound(n))->second;
-}
+  char const*      first_;  // The buffer
+  char const*      last_;
+  std::vector<int> starts_; // The offset of each line
+};
 
 
 #endif
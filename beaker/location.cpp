@@ -4,12 +4,116 @@
 #include "location.hpp"
 #include "file.hpp"
 
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+
+// -------------------------------------------------------------------------- //
+// Source map
+
+// Register the buffer [first, last) of the file f. Returns
+// the offset of the first character of the buffer.
+std::uint32_t
+Source_map::add(File const* f, char const* first, char const* last)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t n = last - first;
+  if (n >= std::numeric_limits<std::uint32_t>::max() - next_)
+    throw std::runtime_error("source too large");
+  std::uint32_t base = next_;
+  bufs_.push_back({base, std::uint32_t(n), f, first, nullptr});
+  next_ += n + 1;
+  return base;
+}
+
+
+// Remove the buffer whose first offset is base. Its
+// offsets are not given to another buffer.
+void
+Source_map::remove(std::uint32_t base)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = std::find_if(bufs_.begin(), bufs_.end(), [base](Entry const& e) {
+    return e.base == base;
+  });
+  if (iter != bufs_.end())
+    bufs_.erase(iter);
+}
+
+
+// Returns the buffer containing the offset off, or nullptr
+// if there is none. The caller holds the lock.
+Source_map::Entry*
+Source_map::find(std::uint32_t off)
+{
+  auto iter = std::upper_bound(bufs_.begin(), bufs_.end(), off, [](std::uint32_t n, Entry const& e) {
+    return n < e.base;
+  });
+  if (!off || iter == bufs_.begin())
+    return nullptr;
+  Entry& e = *--iter;
+  if (off - e.base > e.size)
+    return nullptr;
+  return &e;
+}
+
+
+// Returns the file, line and column of the location.
+Source_position
+Source_map::resolve(Location loc)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::uint32_t off = loc.offset();
+  Entry* p = find(off);
+  if (!p)
+    return {};
+  Entry& e = *p;
+  if (!e.lines)
+    e.lines.reset(new Line_map(e.first, e.first + e.size));
+
+  int n = off - e.base;
+  Line line = e.lines->line(n);
+  Source_position pos;
+  pos.file = e.file;
+  pos.line = line.number();
+  pos.column = n - (line.begin() - e.first);
+  return pos;
+}
+
+
+// Returns the text of the buffer from the location to the
+// end of the buffer, or an empty string if the location is
+// not resolved.
+String_ref
+Source_map::text(Location loc)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::uint32_t off = loc.offset();
+  if (Entry* e = find(off))
+    return String_ref(e->first + (off - e->base), e->size - (off - e->base));
+  return {};
+}
+
+
+Source_map&
+source_map()
+{
+  static Source_map m;
+  return m;
+}
+
+
+// -------------------------------------------------------------------------- //
+// Locations
 
 std::ostream& 
 operator<<(std::ostream& os, Location const& l)
 {
-  if (l.file())
-    os << l.file()->pathname() << ':';
-  os << l.line() << ':' << l.column();
+  Source_position pos = source_map().resolve(l);
+  if (pos.file)
+    os << pos.file->pathname() << ':';
+  os << pos.line << ':' << pos.column;
   return os;
 }
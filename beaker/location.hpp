@@ -4,8 +4,16 @@
 #ifndef BEAKER_LOCATION_HPP
 #define BEAKER_LOCATION_HPP
 
+#include "memory.hpp"
+#include "line.hpp"
+#include "string.hpp"
+
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 
 class File;
@@ -13,30 +21,110 @@ class File;
 
 // A location in source code.
 //
-// FIXME: This should refer into some kind of lexical
-// environment so that we can minimize the size of
-// this object (because there will be lots of them).
+// A location is the offset of a character in the source
+// map (see below), so that every token and term can refer
+// to its source text with a single 32-bit integer. The
+// offset 0 denotes no location. The file, line and column
+// of a location are computed when they are requested,
+// which is normally only to diagnose an error.
 struct Location
 {
 public:
   Location()
-    : file_(nullptr), line_(0), col_(0)
+    : off_(0)
   { }
 
-  Location(File const* f, int l, int o)
-    : file_(f), line_(l), col_(o)
+  explicit Location(std::uint32_t n)
+    : off_(n)
   { }
 
-  File const* file() const   { return file_; }
-  int         line() const   { return line_; }
-  int         column() const { return col_; }
+  std::uint32_t offset() const { return off_; }
+
+  File const* file() const;
+  int         line() const;
+  int         column() const;
+
+  std::uint32_t off_;
+};
+
 
-  File const* file_;
-  int         line_;
-  int         col_;
+// The file, line and column of a location. Columns are
+// counted from 0.
+struct Source_position
+{
+  File const* file = nullptr;
+  int         line = 0;
+  int         column = 0;
 };
 
 
+// The source map assigns each source buffer a range
+// of offsets so that locations in different buffers
+// are distinct. The range of a buffer includes the
+// position past its last character.
+//
+// Buffers register themselves when they are created
+// and are removed when they are destroyed. Locations
+// in a removed buffer are not resolved. The line map
+// of a buffer is built the first time one of its
+// locations is resolved. Offsets are never reused, so
+// a stale location cannot resolve to a later buffer.
+// This limits a process to 4 GB of source text.
+class Source_map
+{
+public:
+  std::uint32_t add(File const*, char const*, char const*);
+  void          remove(std::uint32_t);
+
+  Source_position resolve(Location);
+  String_ref      text(Location);
+
+private:
+  struct Entry
+  {
+    std::uint32_t             base;  // The offset of the first character
+    std::uint32_t             size;  // The number of characters
+    File const*               file;  // The file, if any
+    char const*               first; // The text of the buffer
+    std::unique_ptr<Line_map> lines; // The lines of the buffer, once built
+  };
+
+  Entry* find(std::uint32_t);
+
+  std::vector<Entry> bufs_;
+  std::uint32_t      next_ = 1;  // The base of the next buffer
+  std::mutex         mutex_;
+};
+
+
+Source_map& source_map();
+
+
+// Returns the file containing the location, if any.
+inline File const*
+Location::file() const
+{
+  return source_map().resolve(*this).file;
+}
+
+
+// Returns the line of the location, or 0 if it is
+// not resolved.
+inline int
+Location::line() const
+{
+  return source_map().resolve(*this).line;
+}
+
+
+// Returns the column of the location.
+inline int
+Location::column() const
+{
+  return source_map().resolve(*this).column;
+}
+
+
 // The location map associates terms of the
 // language with their location in source code.
 // Note that types do not have a source code
@@ -48,10 +136,22 @@ struct Location_map : std::unordered_map<void const*, Location>
 {
   using std::unordered_map<void const*, Location>::unordered_map;
 
+  void     put(void const*, Location);
   Location get(void const*) const;
 };
 
 
+// Associate the term p with the location l.
+inline void
+Location_map::put(void const* p, Location l)
+{
+  if (emplace(p, l).second) {
+    static int k = memory_report().classify("Location_map entry");
+    memory_report().allocate(k, sizeof(value_type), 1);
+  }
+}
+
+
 inline Location
 Location_map::get(void const* p) const
 {
@@ -0,0 +1,27 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_MAKE_HPP
+#define BEAKER_MAKE_HPP
+
+#include "stats.hpp"
+#include "memory.hpp"
+
+#include <utility>
+
+
+// Allocate a new AST node of type T, initialized with
+// the given arguments. All terms created by the front end
+// should be allocated through this function so that they
+// are visible to the compiler's instrumentation.
+template<typename T, typename... Args>
+inline T*
+make(Args&&... args)
+{
+  ++node_counter<T>();
+  memory_report().allocate<T>();
+  return new T(std::forward<Args>(args)...);
+}
+
+
+#endif
@@ -0,0 +1,151 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "memory.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/resource.h>
+
+
+// Returns the global memory report.
+Memory_report&
+memory_report()
+{
+  static Memory_report r;
+  return r;
+}
+
+
+// Returns the peak resident set size of the process,
+// in kilobytes.
+long
+peak_rss()
+{
+  rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru))
+    return 0;
+#if defined(__APPLE__)
+  return ru.ru_maxrss / 1024;
+#else
+  return ru.ru_maxrss;
+#endif
+}
+
+
+// Attribute subsequent allocations to the phase r.
+void
+Memory_report::enter(Time_region r)
+{
+  if (r <= evaluation_time)
+    phase_ = r;
+}
+
+
+// Leave the phase r, recording the peak RSS reached
+// by the end of the phase.
+void
+Memory_report::leave(Time_region r)
+{
+  if (r <= evaluation_time) {
+    peak_[r] = peak_rss();
+    phase_ = num_memory_phases - 1;
+  }
+}
+
+
+// Register a new class of objects, returning its
+// identifier.
+int
+Memory_report::classify(String const& name)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  classes_.push_back(name);
+  return classes_.size() - 1;
+}
+
+
+// Returns the total allocations in phase p.
+Memory_record
+Memory_report::total(int p) const
+{
+  Memory_record sum;
+  for (Memory_record const& r : records_[p]) {
+    sum.bytes += r.bytes;
+    sum.count += r.count;
+  }
+  return sum;
+}
+
+
+namespace
+{
+
+char const*
+phase_name(int p)
+{
+  if (p <= evaluation_time)
+    return region_name(Time_region(p));
+  else
+    return "other";
+}
+
+
+void
+print_row(std::ostream& os, String const& name, Memory_record const& rec)
+{
+  os << "  " << std::left << std::setw(32) << name << std::right
+     << std::setw(14) << rec.bytes
+     << std::setw(12) << rec.count << '\n';
+}
+
+} // namespace
+
+
+// Print the report. At most n classes are listed for
+// each phase, ranked by bytes.
+void
+Memory_report::print(std::ostream& os, std::size_t n) const
+{
+  using Entry = std::pair<int, Memory_record>;
+
+  os << "memory:\n";
+  os << "  " << std::left << std::setw(32) << "phase / class" << std::right
+     << std::setw(14) << "bytes"
+     << std::setw(12) << "objects"
+     << std::setw(14) << "peak RSS (KB)" << '\n';
+
+  Memory_record all;
+  for (int p = 0; p < num_memory_phases; ++p) {
+    std::vector<Memory_record> const& v = records_[p];
+    if (v.empty() && !peak_[p])
+      continue;
+
+    std::vector<Entry> ents;
+    for (std::size_t k = 0; k < v.size(); ++k) {
+      if (v[k].count)
+        ents.emplace_back(k, v[k]);
+    }
+    Memory_record sum = total(p);
+    all.bytes += sum.bytes;
+    all.count += sum.count;
+
+    os << "  " << std::left << std::setw(32) << phase_name(p) << std::right
+       << std::setw(14) << sum.bytes
+       << std::setw(12) << sum.count;
+    if (peak_[p])
+      os << std::setw(14) << peak_[p];
+    os << '\n';
+
+    std::sort(ents.begin(), ents.end(), [](Entry const& a, Entry const& b) {
+      return a.second.bytes > b.second.bytes;
+    });
+    if (ents.size() > n)
+      ents.resize(n);
+    for (Entry const& e : ents)
+      print_row(os, "  " + classes_[e.first], e.second);
+  }
+  print_row(os, "total", all);
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_MEMORY_HPP
+#define BEAKER_MEMORY_HPP
+
+// The memory module supports the -fmem-report option. It
+// accounts for the objects allocated by the compiler in
+// each phase of translation, broken down by class, and
+// samples the peak resident set size at the end of each
+// phase.
+//
+// Bytes are the sizes of the objects requested; they do
+// not include allocator or container overhead. Accounting
+// is disabled by default. When disabled, an allocation
+// costs one test of a flag.
+
+#include "string.hpp"
+#include "stats.hpp"
+#include "timer.hpp"
+
+#include <iosfwd>
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
+
+// Accumulated allocations for a class of objects.
+struct Memory_record
+{
+  std::size_t bytes = 0;
+  std::size_t count = 0;
+};
+
+
+// Allocations made outside of any phase (e.g., during
+// static initialization) are attributed to this phase.
+constexpr int num_memory_phases = evaluation_time + 2;
+
+
+// The memory report accumulates allocation records for
+// each phase and class.
+class Memory_report
+{
+public:
+  bool enabled() const { return on_; }
+  void enable()        { on_ = true; }
+
+  void enter(Time_region);
+  void leave(Time_region);
+
+  int classify(String const&);
+
+  template<typename T>
+  void allocate(std::size_t = 1);
+  void allocate(int, std::size_t, std::size_t);
+
+  Memory_record total(int) const;
+
+  void print(std::ostream&, std::size_t = 10) const;
+
+private:
+  bool                       on_ = false;
+  int                        phase_ = num_memory_phases - 1;
+  std::vector<String>        classes_;
+  std::vector<Memory_record> records_[num_memory_phases];
+  long                       peak_[num_memory_phases] = { };
+  std::mutex                 mutex_;  // Guards classes and records
+};
+
+
+Memory_report& memory_report();
+
+long peak_rss();
+
+
+// Returns the class identifier for objects of type T.
+template<typename T>
+inline int
+memory_class()
+{
+  static int k = memory_report().classify(type_name(typeid(T)));
+  return k;
+}
+
+
+// Record the allocation of n objects of type T.
+template<typename T>
+inline void
+Memory_report::allocate(std::size_t n)
+{
+  if (on_)
+    allocate(memory_class<T>(), n * sizeof(T), n);
+}
+
+
+// Record the allocation of n objects of class k, whose
+// total size is b bytes.
+inline void
+Memory_report::allocate(int k, std::size_t b, std::size_t n)
+{
+  if (!on_)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Memory_record>& v = records_[phase_];
+  if (v.size() <= std::size_t(k))
+    v.resize(k + 1);
+  v[k].bytes += b;
+  v[k].count += n;
+}
+
+
+#endif
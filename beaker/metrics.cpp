@@ -0,0 +1,154 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "metrics.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+
+
+Function_metrics&
+Function_metrics::operator+=(Function_metrics const& m)
+{
+  blocks += m.blocks;
+  insts += m.insts;
+  allocas += m.allocas;
+  loads += m.loads;
+  stores += m.stores;
+  empty += m.empty;
+  dead += m.dead;
+  return *this;
+}
+
+
+// Measure the function f.
+Function_metrics
+measure(llvm::Function const& f)
+{
+  Function_metrics m;
+  for (llvm::BasicBlock const& b : f) {
+    ++m.blocks;
+    m.insts += b.size();
+    if (b.size() == 1 && !llvm::isa<llvm::ReturnInst>(b.getTerminator()))
+      ++m.empty;
+    if (&b != &f.getEntryBlock() && llvm::pred_begin(&b) == llvm::pred_end(&b))
+      ++m.dead;
+    for (llvm::Instruction const& i : b) {
+      if (llvm::isa<llvm::AllocaInst>(i))
+        ++m.allocas;
+      else if (llvm::isa<llvm::LoadInst>(i))
+        ++m.loads;
+      else if (llvm::isa<llvm::StoreInst>(i))
+        ++m.stores;
+    }
+  }
+  return m;
+}
+
+
+// Measure each function defined in the module.
+Module_metrics
+measure(llvm::Module const& mod)
+{
+  Module_metrics ms;
+  for (llvm::Function const& f : mod) {
+    if (!f.isDeclaration())
+      ms.emplace_back(f.getName().str(), measure(f));
+  }
+  return ms;
+}
+
+
+// Apply the standard optimization pipeline at the given
+// level to the module.
+void
+optimize(llvm::Module& mod, unsigned level)
+{
+  llvm::PassManagerBuilder pmb;
+  pmb.OptLevel = level;
+
+  llvm::legacy::FunctionPassManager fpm(&mod);
+  pmb.populateFunctionPassManager(fpm);
+  fpm.doInitialization();
+  for (llvm::Function& f : mod)
+    fpm.run(f);
+  fpm.doFinalization();
+
+  llvm::legacy::PassManager mpm;
+  pmb.populateModulePassManager(mpm);
+  mpm.run(mod);
+}
+
+
+namespace
+{
+
+// Print a metric before and after optimization.
+void
+print_cell(std::ostream& os, std::size_t a, std::size_t const* b)
+{
+  std::stringstream ss;
+  ss << a << '/';
+  if (b)
+    ss << *b;
+  else
+    ss << '-';
+  os << std::setw(12) << ss.str();
+}
+
+
+void
+print_row(std::ostream& os, std::string const& name,
+          Function_metrics const& a, Function_metrics const* b)
+{
+  os << std::left << std::setw(24) << name << std::right;
+  print_cell(os, a.blocks, b ? &b->blocks : nullptr);
+  print_cell(os, a.insts, b ? &b->insts : nullptr);
+  print_cell(os, a.allocas, b ? &b->allocas : nullptr);
+  print_cell(os, a.loads, b ? &b->loads : nullptr);
+  print_cell(os, a.stores, b ? &b->stores : nullptr);
+  print_cell(os, a.empty, b ? &b->empty : nullptr);
+  print_cell(os, a.dead, b ? &b->dead : nullptr);
+  os << '\n';
+}
+
+} // namespace
+
+
+// Print the metrics of each function before and after
+// optimization. Each cell shows the value before and after,
+// separated by a slash. Functions removed by optimization
+// (e.g., by inlining) have no value after.
+void
+print_metrics(std::ostream& os, Module_metrics const& before, Module_metrics const& after)
+{
+  os << std::left << std::setw(24) << "function" << std::right
+     << std::setw(12) << "blocks"
+     << std::setw(12) << "insts"
+     << std::setw(12) << "allocas"
+     << std::setw(12) << "loads"
+     << std::setw(12) << "stores"
+     << std::setw(12) << "empty"
+     << std::setw(12) << "dead" << '\n';
+
+  Function_metrics t1;
+  Function_metrics t2;
+  for (auto const& x : before) {
+    Function_metrics const* m = nullptr;
+    for (auto const& y : after) {
+      if (y.first == x.first)
+        m = &y.second;
+    }
+    print_row(os, x.first, x.second, m);
+    t1 += x.second;
+  }
+  for (auto const& y : after)
+    t2 += y.second;
+  print_row(os, "total", t1, &t2);
+}
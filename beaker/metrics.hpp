@@ -0,0 +1,48 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_METRICS_HPP
+#define BEAKER_METRICS_HPP
+
+// The metrics module supports the -fcodegen-metrics option.
+// It measures the quality of the code produced by the
+// generator, so that changes to code generation can be
+// evaluated. Each function is measured as generated, and
+// again after a standard optimization pipeline. The gap
+// between the two is the waste that the generator leaves
+// for the optimizer to clean up.
+
+#include <iosfwd>
+#include <vector>
+
+#include <llvm/IR/Module.h>
+
+
+// Code quality metrics for a single function.
+struct Function_metrics
+{
+  std::size_t blocks = 0;   // Basic blocks
+  std::size_t insts = 0;    // Instructions
+  std::size_t allocas = 0;  // Stack allocations
+  std::size_t loads = 0;    // Loads
+  std::size_t stores = 0;   // Stores
+  std::size_t empty = 0;    // Blocks containing only a branch or unreachable
+  std::size_t dead = 0;     // Unreachable blocks
+
+  Function_metrics& operator+=(Function_metrics const&);
+};
+
+
+// The metrics of each function defined in a module.
+using Module_metrics = std::vector<std::pair<std::string, Function_metrics>>;
+
+
+Function_metrics measure(llvm::Function const&);
+Module_metrics measure(llvm::Module const&);
+
+void optimize(llvm::Module&, unsigned = 2);
+
+void print_metrics(std::ostream&, Module_metrics const&, Module_metrics const&);
+
+
+#endif
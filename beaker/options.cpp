@@ -0,0 +1,163 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "options.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+namespace
+{
+
+// Returns true if arg starts with the given prefix.
+inline bool
+starts_with(char const* arg, char const* prefix)
+{
+  return std::strncmp(arg, prefix, std::strlen(prefix)) == 0;
+}
+
+
+bool
+parse_eval(Options& opts, char const* mode)
+{
+  if (!std::strcmp(mode, "fast"))
+    opts.eval = fast_eval;
+  else if (!std::strcmp(mode, "profile"))
+    opts.eval = profile_eval;
+  else if (!std::strcmp(mode, "trace"))
+    opts.eval = trace_eval;
+  else {
+    std::cerr << "error: unknown evaluation mode '" << mode << "'\n";
+    return false;
+  }
+  return true;
+}
+
+
+bool
+parse_stats(Options& opts, char const* fmt)
+{
+  if (!std::strcmp(fmt, "table"))
+    opts.stats = table_stats;
+  else if (!std::strcmp(fmt, "json"))
+    opts.stats = json_stats;
+  else {
+    std::cerr << "error: unknown statistics format '" << fmt << "'\n";
+    return false;
+  }
+  return true;
+}
+
+
+
+// Parse a numeric limit into n.
+bool
+parse_limit(std::size_t& n, char const* arg, char const* val)
+{
+  char* end;
+  n = std::strtoull(val, &end, 10);
+  if (!*val || *end) {
+    std::cerr << "error: invalid limit '" << arg << "'\n";
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+
+// Parse the command line into opts. Returns false, after
+// diagnosing the problem, if the command line is invalid.
+bool
+parse_options(Options& opts, int argc, char* argv[])
+{
+  for (int i = 1; i < argc; ++i) {
+    char const* arg = argv[i];
+    if (starts_with(arg, "-feval=")) {
+      if (!parse_eval(opts, arg + 7))
+        return false;
+    }
+    else if (!std::strcmp(arg, "-ftime-report")) {
+      opts.time = true;
+    }
+    else if (!std::strcmp(arg, "-fmem-report")) {
+      opts.mem = true;
+    }
+    else if (!std::strcmp(arg, "-fcodegen-metrics")) {
+      opts.metrics = true;
+    }
+    else if (!std::strcmp(arg, "-flazy-lex")) {
+      opts.lazy_lex = true;
+    }
+    else if (starts_with(arg, "-flex-threads=")) {
+      if (!parse_limit(opts.lex_threads, arg, arg + 14))
+        return false;
+    }
+    else if (starts_with(arg, "-flex-chunk=")) {
+      if (!parse_limit(opts.lex_chunk, arg, arg + 12))
+        return false;
+    }
+    else if (starts_with(arg, "-ftrace=")) {
+      opts.trace = arg + 8;
+    }
+    else if (starts_with(arg, "-fserver=")) {
+      opts.server = arg + 9;
+    }
+    else if (starts_with(arg, "-fserver-jobs=")) {
+      if (!parse_limit(opts.server_jobs, arg, arg + 14))
+        return false;
+    }
+    else if (starts_with(arg, "-fsnapshot=")) {
+      opts.snapshot = arg + 11;
+    }
+    else if (!std::strcmp(arg, "-ftrace-calls")) {
+      opts.eval = trace_calls_eval;
+    }
+    else if (!std::strcmp(arg, "--stats")) {
+      opts.stats = table_stats;
+    }
+    else if (starts_with(arg, "--stats=")) {
+      if (!parse_stats(opts, arg + 8))
+        return false;
+    }
+    else if (starts_with(arg, "-flimit-fuel=")) {
+      if (!parse_limit(opts.fuel, arg, arg + 13))
+        return false;
+    }
+    else if (starts_with(arg, "-flimit-heap=")) {
+      if (!parse_limit(opts.heap, arg, arg + 13))
+        return false;
+    }
+    else if (starts_with(arg, "-flimit-depth=")) {
+      if (!parse_limit(opts.depth, arg, arg + 14))
+        return false;
+    }
+    else if (arg[0] == '-') {
+      std::cerr << "error: unknown option '" << arg << "'\n";
+      return false;
+    }
+    else if (opts.input) {
+      std::cerr << "error: multiple input files\n";
+      return false;
+    }
+    else {
+      opts.input = arg;
+    }
+  }
+
+  if (!opts.input) {
+    std::cerr << "error: no input file\n";
+    return false;
+  }
+  if (opts.eval == trace_calls_eval && !opts.trace) {
+    std::cerr << "error: -ftrace-calls requires -ftrace\n";
+    return false;
+  }
+  if (opts.lazy_lex && opts.lex_threads > 1) {
+    std::cerr << "error: -flazy-lex cannot be used with -flex-threads\n";
+    return false;
+  }
+  return true;
+}
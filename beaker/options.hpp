@@ -0,0 +1,72 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_OPTIONS_HPP
+#define BEAKER_OPTIONS_HPP
+
+#include <cstddef>
+
+
+// The evaluation policy selected for the interpreter.
+// See evaluator.hpp.
+enum Eval_mode
+{
+  fast_eval,         // No instrumentation
+  profile_eval,      // Count calls, statements, and objects
+  trace_eval,        // Trace calls, statements, and objects
+  trace_calls_eval,  // Record calls as trace events
+};
+
+
+// The format of the --stats report.
+enum Stats_mode
+{
+  no_stats,     // Don't report statistics
+  table_stats,  // Print a table
+  json_stats,   // Print a JSON object
+};
+
+
+// Command line options for the compiler and interpreter.
+//
+//    -feval=fast|profile|trace   Select the evaluation policy
+//    -ftime-report               Print the time spent in each phase
+//    -fmem-report                Print the memory allocated in each phase
+//    -fcodegen-metrics           Print code quality metrics instead of IR
+//    -flazy-lex                  Lex each token when the parser needs it
+//    -flex-threads=<n>           Lex large files on n threads
+//    -flex-chunk=<bytes>         Lex at least this much per thread
+//    -ftrace=<file>              Write a Chrome trace of each phase
+//    -ftrace-calls               Also trace interpreted calls
+//    -flimit-fuel=<n>            Bound the calls and loop iterations
+//    -flimit-heap=<bytes>        Bound the memory allocated for objects
+//    -flimit-depth=<n>           Bound the depth of calls (default 4096)
+//    -fserver=<socket>|-         Run the program on each request
+//    -fserver-jobs=<n>           Run at most n requests at once
+//    -fsnapshot=<file>           Restore initialized globals from a snapshot
+//    --stats[=table|json]        Print the value of each counter
+struct Options
+{
+  char const* input = nullptr;   // The input file
+  Eval_mode   eval = fast_eval;  // The interpreter's policy
+  bool        time = false;      // Report phase times
+  bool        mem = false;       // Report phase allocations
+  bool        metrics = false;   // Report generated code quality
+  bool        lazy_lex = false;  // Lex on demand
+  std::size_t lex_threads = 1;   // Threads used for lexing
+  std::size_t lex_chunk = 0;     // Bytes lexed per thread, or 0 for the default
+  char const* trace = nullptr;   // The trace file, if any
+  Stats_mode  stats = no_stats;  // Report counters
+  char const* server = nullptr;  // The server's socket, if any
+  std::size_t server_jobs = 0;   // Concurrent requests, or 0 for one per CPU
+  char const* snapshot = nullptr; // The snapshot file, if any
+  std::size_t fuel = 0;          // Fuel limit, or 0 if unbounded
+  std::size_t heap = 0;          // Heap limit, or 0 if unbounded
+  std::size_t depth = 4096;      // Call depth limit, or 0 if unbounded
+};
+
+
+bool parse_options(Options&, int, char*[]);
+
+
+#endif
@@ -76,7 +76,7 @@ Parser::postfix_expr()
     }
 
     // call-expr
-    else if (match_if(lparen_tok)) {
+    else if (Token tok = match_if(lparen_tok)) {
       Expr_seq args;
       while (lookahead() != rparen_tok) {
         args.push_back(expr());
@@ -86,7 +86,7 @@ Parser::postfix_expr()
           break;
       }
       match(rparen_tok);
-      e1 = on_call(e1, args);
+      e1 = on_call(tok, e1, args);
     }
 
     // index-expr
@@ -610,12 +610,13 @@ Parser::block_stmt()
 {
   Stmt_seq stmts;
   require(lbrace_tok);
-  while (lookahead() != rbrace_tok) {
+  while (!ts_.eof() && lookahead() != rbrace_tok) {
     try {
       Stmt* s = stmt();
       stmts.push_back(s);
     } catch (Translation_error& err) {
-      diagnose(err);
+      if (!ts_.failed())
+        diagnose(err);
       consume_thru(term_);
     }
   }
@@ -671,12 +672,12 @@ Parser::if_stmt()
 Stmt*
 Parser::while_stmt()
 {
-  require(while_kw);
+  Token tok = require(while_kw);
   match(lparen_tok);
   Expr* e = expr();
   match(rparen_tok);
   Stmt* s = stmt();
-  return on_while(e, s);
+  return on_while(tok, e, s);
 }
 
 
@@ -789,6 +790,10 @@ Parser::stmt()
 //
 //    decl-seq -> decl | decl-seq
 //
+// Errors are not diagnosed once the token stream has
+// failed, since its input ends at the first lexical
+// error (see Lexer::pull).
+//
 // TODO: Return an empty module.
 Decl*
 Parser::module()
@@ -799,7 +804,8 @@ Parser::module()
       Decl* d = decl();
       decls.push_back(d);
     } catch (Translation_error& err) {
-      diagnose(err);
+      if (!ts_.failed())
+        diagnose(err);
       consume_thru(term_);
     }
   }
@@ -817,8 +823,11 @@ Parser::match(Token_kind k)
     return ts_.get();
 
   std::stringstream ss;
-  ss << "expected '" << spelling(k)
-     << "' but got '" <<  ts_.peek().spelling() << "'";
+  ss << "expected '" << spelling(k) << "' but got ";
+  if (ts_.eof())
+    ss << "end of input";
+  else
+    ss << "'" << ts_.peek().spelling(syms_, lits_) << "'";
   error(ss.str());
 }
 
@@ -903,8 +912,8 @@ Parser::error(String const& msg)
 Type const*
 Parser::on_id_type(Token tok)
 {
-  Type const* t = get_id_type(tok.symbol());
-  locs_->emplace(t, tok.location());
+  Type const* t = get_id_type(tok.symbol(syms_));
+  locs_->put(t, tok.location());
   return t;
 }
 
@@ -933,7 +942,7 @@ Parser::on_function_type(Type_seq const& ts, Type const* t)
 Expr*
 Parser::on_id(Token tok)
 {
-  return init<Id_expr>(tok.location(), tok.symbol());
+  return init<Id_expr>(tok.location(), tok.symbol(syms_));
 }
 
 
@@ -941,7 +950,7 @@ Expr*
 Parser::on_bool(Token tok)
 {
   Type const* t = get_boolean_type();
-  int v = tok.boolean_symbol()->value();
+  int v = tok.boolean_symbol(syms_)->value();
   return init<Literal_expr>(tok.location(), t, v);
 }
 
@@ -950,7 +959,7 @@ Expr*
 Parser::on_int(Token tok)
 {
   Type const* t = get_integer_type();
-  int v = tok.integer_symbol()->value();
+  int v = tok.integer_value(lits_);
   return init<Literal_expr>(tok.location(), t, v);
 }
 
@@ -959,7 +968,7 @@ Expr*
 Parser::on_char(Token tok)
 {
   Type const* t = get_character_type();
-  int v = tok.character_symbol()->value();
+  int v = tok.character_value();
   return init<Literal_expr>(tok.location(), t, v);
 }
 
@@ -970,17 +979,17 @@ Expr*
 Parser::on_str(Token tok)
 {
   // Build the string value.
-  String_sym const* s = tok.string_symbol();
+  String const& s = tok.string_value(lits_);
   Array_value v {
-     s->value().c_str(),
-     s->value().size()
+     s.c_str(),
+     s.size()
   };
 
   // Create the extent of the literal array. This is
   // explicitly more than the length of the string,
   // and includes the null character.
   Type const* z = get_integer_type();
-  Expr* n = new Literal_expr(z, v.len + 1);
+  Expr* n = make<Literal_expr>(z, v.len + 1);
 
   // Create the array type.
   Type const* c = get_character_type();
@@ -993,132 +1002,133 @@ Parser::on_str(Token tok)
 Expr*
 Parser::on_add(Expr* e1, Expr* e2)
 {
-  return new Add_expr(e1, e2);
+  return make<Add_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_sub(Expr* e1, Expr* e2)
 {
-  return new Sub_expr(e1, e2);
+  return make<Sub_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_mul(Expr* e1, Expr* e2)
 {
-  return new Mul_expr(e1, e2);
+  return make<Mul_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_div(Expr* e1, Expr* e2)
 {
-  return new Div_expr(e1, e2);
+  return make<Div_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_rem(Expr* e1, Expr* e2)
 {
-  return new Rem_expr(e1, e2);
+  return make<Rem_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_neg(Expr* e)
 {
-  return new Neg_expr(e);
+  return make<Neg_expr>(e);
 }
 
 
 Expr*
 Parser::on_pos(Expr* e)
 {
-  return new Pos_expr(e);
+  return make<Pos_expr>(e);
 }
 
 
 Expr*
 Parser::on_eq(Expr* e1, Expr* e2)
 {
-  return new Eq_expr(e1, e2);
+  return make<Eq_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_ne(Expr* e1, Expr* e2)
 {
-  return new Ne_expr(e1, e2);
+  return make<Ne_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_lt(Expr* e1, Expr* e2)
 {
-  return new Lt_expr(e1, e2);
+  return make<Lt_expr>(e1, e2);
 }
 
 Expr*
 Parser::on_gt(Expr* e1, Expr* e2)
 {
-  return new Gt_expr(e1, e2);
+  return make<Gt_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_le(Expr* e1, Expr* e2)
 {
-  return new Le_expr(e1, e2);
+  return make<Le_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_ge(Expr* e1, Expr* e2)
 {
-  return new Ge_expr(e1, e2);
+  return make<Ge_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_and(Expr* e1, Expr* e2)
 {
-  return new And_expr(e1, e2);
+  return make<And_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_or(Expr* e1, Expr* e2)
 {
-  return new Or_expr(e1, e2);
+  return make<Or_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_not(Expr* e)
 {
-  return new Not_expr(e);
+  return make<Not_expr>(e);
 }
 
 
+// The location of a call is that of its argument list.
 Expr*
-Parser::on_call(Expr* e, Expr_seq const& a)
+Parser::on_call(Token tok, Expr* e, Expr_seq const& a)
 {
-  return new Call_expr(e, a);
+  return init<Call_expr>(tok.location(), e, a);
 }
 
 
 Expr*
 Parser::on_index(Expr* e1, Expr* e2)
 {
-  return new Index_expr(e1, e2);
+  return make<Index_expr>(e1, e2);
 }
 
 
 Expr*
 Parser::on_dot(Expr* e1, Expr* e2)
 {
-  return new Member_expr(e1, e2);
+  return make<Member_expr>(e1, e2);
 }
 
 
@@ -1130,16 +1140,16 @@ Parser::on_dot(Expr* e1, Expr* e2)
 Decl*
 Parser::on_variable(Specifier spec, Token tok, Type const* t)
 {
-  Expr* init = new Default_init(t);
-  return new Variable_decl(spec, tok.symbol(), t, init);
+  Expr* init = make<Default_init>(t);
+  return make<Variable_decl>(spec, tok.symbol(syms_), t, init);
 }
 
 
 Decl*
 Parser::on_variable(Specifier spec, Token tok, Type const* t, Expr* e)
 {
-  Expr* init = new Copy_init(t, e);
-  return new Variable_decl(spec, tok.symbol(), t, init);
+  Expr* init = make<Copy_init>(t, e);
+  return make<Variable_decl>(spec, tok.symbol(syms_), t, init);
 }
 
 
@@ -1149,14 +1159,14 @@ Parser::on_parameter(Specifier spec, Type const* t)
 {
   // Create (or get) an empty identifier.
   Symbol const* s = syms_.put<Identifier_sym>("", identifier_tok);
-  return new Parameter_decl(spec, s, t);
+  return make<Parameter_decl>(spec, s, t);
 }
 
 
 Decl*
 Parser::on_parameter(Specifier spec, Token tok, Type const* t)
 {
-  return new Parameter_decl(tok.symbol(), t);
+  return make<Parameter_decl>(tok.symbol(syms_), t);
 }
 
 
@@ -1166,7 +1176,7 @@ Decl*
 Parser::on_function(Specifier spec, Token tok, Decl_seq const& p, Type const* t)
 {
   Type const* f = get_function_type(p, t);
-  return new Function_decl(tok.symbol(), f, p, nullptr);
+  return make<Function_decl>(tok.symbol(syms_), f, p, nullptr);
 }
 
 
@@ -1174,21 +1184,21 @@ Decl*
 Parser::on_function(Specifier spec, Token tok, Decl_seq const& p, Type const* t, Stmt* b)
 {
   Type const* f = get_function_type(p, t);
-  return new Function_decl(tok.symbol(), f, p, b);
+  return make<Function_decl>(tok.symbol(syms_), f, p, b);
 }
 
 
 Decl*
 Parser::on_record(Specifier spec, Token n, Decl_seq const& fs)
 {
-  return new Record_decl(n.symbol(), fs);
+  return make<Record_decl>(n.symbol(syms_), fs);
 }
 
 
 Decl*
 Parser::on_field(Specifier spec, Token n, Type const* t)
 {
-  return new Field_decl(n.symbol(), t);
+  return make<Field_decl>(n.symbol(syms_), t);
 }
 
 
@@ -1198,82 +1208,82 @@ Decl*
 Parser::on_module(Decl_seq const& d)
 {
   Symbol const* sym = syms_.get("<input>");
-  return new Module_decl(sym, d);
+  return make<Module_decl>(sym, d);
 }
 
 
 Stmt*
 Parser::on_empty()
 {
-  return new Empty_stmt();
+  return make<Empty_stmt>();
 }
 
 
 Stmt*
 Parser::on_block(std::vector<Stmt*> const& s)
 {
-  return new Block_stmt(s);
+  return make<Block_stmt>(s);
 }
 
 
 Stmt*
 Parser::on_assign(Expr* e1, Expr* e2)
 {
-  return new Assign_stmt(e1, e2);
+  return make<Assign_stmt>(e1, e2);
 }
 
 
 Stmt*
 Parser::on_return(Expr* e)
 {
-  return new Return_stmt(e);
+  return make<Return_stmt>(e);
 }
 
 
 Stmt*
 Parser::on_if_then(Expr* e, Stmt* s)
 {
-  return new If_then_stmt(e, s);
+  return make<If_then_stmt>(e, s);
 }
 
 
 Stmt*
 Parser::on_if_else(Expr* e, Stmt* s1, Stmt* s2)
 {
-  return new If_else_stmt(e, s1, s2);
+  return make<If_else_stmt>(e, s1, s2);
 }
 
 
 Stmt*
-Parser::on_while(Expr* c, Stmt* s)
+Parser::on_while(Token tok, Expr* c, Stmt* s)
 {
-  return new While_stmt(c, s);
+  return init<While_stmt>(tok.location(), c, s);
 }
 
 
 Stmt*
 Parser::on_break()
 {
-  return new Break_stmt();
+  return make<Break_stmt>();
 }
 
 
 Stmt*
 Parser::on_continue()
 {
-  return new Continue_stmt();
+  return make<Continue_stmt>();
 }
 
 
 Stmt*
 Parser::on_expression(Expr* e)
 {
-  return new Expression_stmt(e);
+  return make<Expression_stmt>(e);
 }
 
 
 Stmt*
 Parser::on_declaration(Decl* d)
 {
-  return new Declaration_stmt(d);
+  return make<Declaration_stmt>(d);
 }
@@ -8,6 +8,7 @@
 #include "string.hpp"
 #include "token.hpp"
 #include "specifier.hpp"
+#include "make.hpp"
 
 
 class Input_buffer;
@@ -18,8 +19,8 @@ class Input_buffer;
 class Parser
 {
 public:
-  Parser(Symbol_table&, Token_stream&);
-  Parser(Symbol_table&, Token_stream&, Location_map&);
+  Parser(Symbol_table_ref, Literal_pool&, Token_stream&);
+  Parser(Symbol_table_ref, Literal_pool&, Token_stream&, Location_map&);
 
   // Expression parsers
   Expr* primary_expr();
@@ -96,7 +97,7 @@ private:
   Expr* on_and(Expr*, Expr*);
   Expr* on_or(Expr*, Expr*);
   Expr* on_not(Expr*);
-  Expr* on_call(Expr*, Expr_seq const&);
+  Expr* on_call(Token, Expr*, Expr_seq const&);
   Expr* on_index(Expr*, Expr*);
   Expr* on_dot(Expr*, Expr*);
 
@@ -117,7 +118,7 @@ private:
   Stmt* on_return(Expr*);
   Stmt* on_if_then(Expr*, Stmt*);
   Stmt* on_if_else(Expr*, Stmt*, Stmt*);
-  Stmt* on_while(Expr*, Stmt*);
+  Stmt* on_while(Token, Expr*, Stmt*);
   Stmt* on_break();
   Stmt* on_continue();
   Stmt* on_expression(Expr*);
@@ -142,7 +143,8 @@ private:
   T* init(Location, Args&&...);
 
 private:
-  Symbol_table& syms_;
+  Symbol_table_ref syms_;
+  Literal_pool& lits_;
   Token_stream& ts_;
   Location_map* locs_;
 
@@ -156,14 +158,14 @@ private:
 
 
 inline
-Parser::Parser(Symbol_table& s, Token_stream& t)
-  : syms_(s), ts_(t), locs_(nullptr), errs_(0), term_()
+Parser::Parser(Symbol_table_ref s, Literal_pool& l, Token_stream& t)
+  : syms_(s), lits_(l), ts_(t), locs_(nullptr), errs_(0), term_()
 { }
 
 
 inline
-Parser::Parser(Symbol_table& s, Token_stream& t, Location_map& l)
-  : syms_(s), ts_(t), locs_(&l), errs_(0), term_()
+Parser::Parser(Symbol_table_ref s, Literal_pool& l, Token_stream& t, Location_map& m)
+  : syms_(s), lits_(l), ts_(t), locs_(&m), errs_(0), term_()
 { }
 
 
@@ -191,8 +193,8 @@ template<typename T, typename... Args>
 inline T*
 Parser::init(Location loc, Args&&... args)
 {
-  T* t = new T(std::forward<Args>(args)...);
-  locs_->emplace(t, loc);
+  T* t = make<T>(std::forward<Args>(args)...);
+  locs_->put(t, loc);
   return t;
 }
 
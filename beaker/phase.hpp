@@ -0,0 +1,54 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_PHASE_HPP
+#define BEAKER_PHASE_HPP
+
+// The drivers run translation as a sequence of phases.
+// A phase sentinel brackets a phase, making it visible
+// to the instrumentation enabled on the command line.
+
+#include "timer.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+
+
+// An RAII class that instruments a phase for the duration
+// of its lifetime, or until it is stopped.
+class Phase_sentinel
+{
+public:
+  Phase_sentinel(Time_region);
+  ~Phase_sentinel() { stop(); }
+
+  void stop();
+
+private:
+  Timer_sentinel timer_;
+  Trace_span     span_;
+  Time_region    region_;
+  bool           active_;
+};
+
+
+inline
+Phase_sentinel::Phase_sentinel(Time_region r)
+  : timer_(r), span_("phase", region_name(r)), region_(r), active_(true)
+{
+  memory_report().enter(r);
+}
+
+
+inline void
+Phase_sentinel::stop()
+{
+  if (active_) {
+    memory_report().leave(region_);
+    active_ = false;
+  }
+  span_.stop();
+  timer_.stop();
+}
+
+
+#endif
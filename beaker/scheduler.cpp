@@ -0,0 +1,193 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "scheduler.hpp"
+#include "timer.hpp"
+
+#include <algorithm>
+#include <new>
+#include <thread>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+// The task being started by this thread.
+thread_local Task* starting = nullptr;
+
+} // namespace
+
+
+// -------------------------------------------------------------------------- //
+// Tasks
+
+// Create a task for the main function. Its stack is
+// reserved, but pages are only committed as they are
+// touched. The page below the stack is a guard page, so
+// that overflowing the stack faults rather than writing
+// over an adjacent mapping.
+Task::Task(Scheduler& s, Function_decl const* fn, Limits const& lim)
+  : sched_(s), main_(fn), lim_(lim), spawn_(sample_time().wall)
+{
+  std::size_t guard = sysconf(_SC_PAGESIZE);
+  stack_ = mmap(nullptr, guard + sched_.stack_, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                -1, 0);
+  if (stack_ == MAP_FAILED)
+    throw std::bad_alloc();
+  if (mprotect(stack_, guard, PROT_NONE)) {
+    munmap(stack_, guard + sched_.stack_);
+    throw std::bad_alloc();
+  }
+  getcontext(&ctx_);
+  ctx_.uc_stack.ss_sp = static_cast<char*>(stack_) + guard;
+  ctx_.uc_stack.ss_size = sched_.stack_;
+  ctx_.uc_link = nullptr;
+  makecontext(&ctx_, start, 0);
+}
+
+
+Task::~Task()
+{
+  release();
+}
+
+
+// Release the task's stack.
+void
+Task::release()
+{
+  if (stack_) {
+    munmap(stack_, sysconf(_SC_PAGESIZE) + sched_.stack_);
+    stack_ = nullptr;
+  }
+}
+
+
+// Run the task on the current thread until it yields
+// or is done.
+void
+Task::resume()
+{
+  ucontext_t here;
+  caller_ = &here;
+  starting = this;
+  swapcontext(&here, &ctx_);
+}
+
+
+// Suspend the task, returning to the thread that
+// resumed it.
+void
+Task::operator()()
+{
+  ++slices_;
+  swapcontext(&ctx_, caller_);
+}
+
+
+// The entry point of a task. Errors must be caught
+// here, since they cannot propagate past the bottom
+// of the task's stack.
+void
+Task::start()
+{
+  Task* t = starting;
+  try {
+    Evaluator ev(t->lim_);
+    ev.preempt(t->sched_.slice_, *t);
+    t->result_ = ev.exec(t->main_);
+  } catch (...) {
+    t->error_ = std::current_exception();
+  }
+  t->finish_ = sample_time().wall;
+  t->done_ = true;
+  setcontext(t->caller_);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Scheduler
+
+// Create a scheduler that preempts tasks every slice
+// units of fuel, and gives each task a stack of the
+// given number of bytes.
+Scheduler::Scheduler(std::size_t slice, std::size_t stack)
+  : slice_(slice), stack_(stack)
+{ }
+
+
+// Returns the default limits of a task: its call depth is
+// bounded so that its calls fit in the default stack.
+Limits
+Scheduler::default_limits()
+{
+  Limits lim;
+  lim.depth = default_depth;
+  return lim;
+}
+
+
+// Create a task evaluating fn under the limits. The
+// task's call depth is bounded by the number of calls that
+// fit in its stack, whatever its limit. The task is ready,
+// but does not run until run is called.
+Task&
+Scheduler::spawn(Function_decl const* fn, Limits const& lim)
+{
+  Limits l = lim;
+  std::size_t max = std::max<std::size_t>(stack_ / (default_stack / default_depth), 1);
+  if (l.depth == 0 || l.depth > max)
+    l.depth = max;
+  std::unique_ptr<Task> t(new Task(*this, fn, l));
+  std::lock_guard<std::mutex> lock(mutex_);
+  ready_.push_back(t.get());
+  tasks_.push_back(std::move(t));
+  ++pending_;
+  return *tasks_.back();
+}
+
+
+// Run all tasks to completion on n threads, including
+// the calling thread.
+void
+Scheduler::run(std::size_t n)
+{
+  std::vector<std::thread> pool;
+  for (std::size_t i = 1; i < n; ++i)
+    pool.emplace_back([this]() { work(); });
+  work();
+  for (std::thread& t : pool)
+    t.join();
+}
+
+
+// Resume ready tasks until all tasks are done.
+void
+Scheduler::work()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this]() { return !ready_.empty() || !pending_; });
+    if (!pending_)
+      return;
+    Task* t = ready_.front();
+    ready_.pop_front();
+    lock.unlock();
+
+    t->resume();
+
+    lock.lock();
+    if (t->done_) {
+      t->release();
+      if (--pending_ == 0)
+        cv_.notify_all();
+    } else {
+      ready_.push_back(t);
+      cv_.notify_one();
+    }
+  }
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_SCHEDULER_HPP
+#define BEAKER_SCHEDULER_HPP
+
+// The scheduler runs many independent instances of
+// interpreted programs on a small pool of threads.
+//
+// Each instance is a task: a fiber with its own stack that
+// runs an evaluator. The evaluator is preempted whenever it
+// has spent a time slice of fuel (see Yield in evaluator.hpp),
+// at which point the task suspends and returns to the back of
+// the ready queue. Any thread of the pool may resume it. No
+// thread is ever blocked by a running program, so the latency
+// of a task depends only on the number of tasks ready ahead
+// of it.
+
+#include "evaluator.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <ucontext.h>
+
+
+class Scheduler;
+
+
+// A task evaluates the main function of a program. When
+// the task is done, either its result is set or its error
+// holds the exception that terminated the program.
+class Task : Yield
+{
+  friend class Scheduler;
+public:
+  Task(Scheduler&, Function_decl const*, Limits const&);
+  ~Task();
+
+  bool               done() const { return done_; }
+  Value const&       result() const { return result_; }
+  std::exception_ptr error() const { return error_; }
+  std::size_t        slices() const { return slices_; }
+  double             latency() const { return finish_ - spawn_; }
+
+private:
+  void operator()() override;
+  void resume();
+  void release();
+
+  static void start();
+
+  Scheduler&           sched_;
+  Function_decl const* main_;
+  Limits               lim_;
+  Value                result_;
+  std::exception_ptr   error_;
+  bool                 done_ = false;
+  std::size_t          slices_ = 0;  // Time slices used
+  double               spawn_;       // Wall time when spawned
+  double               finish_ = 0;  // Wall time when done
+  ucontext_t           ctx_;         // The task's context
+  ucontext_t*          caller_;      // The resuming thread's context
+  void*                stack_;       // The guard page and the stack
+};
+
+
+// The scheduler owns its tasks. Tasks are spawned and then
+// run to completion by a call to run.
+//
+// Each call of a program uses some of its task's stack, so
+// the call depth of a task is bounded by the size of its
+// stack: 4096 calls for the default stack, as in the
+// interpreter. An overflow that escapes that bound faults
+// on the guard page below the stack, rather than writing
+// over another mapping.
+class Scheduler
+{
+  friend class Task;
+public:
+  static constexpr std::size_t default_slice = 10000;
+  static constexpr std::size_t default_stack = 8 << 20;
+  static constexpr std::size_t default_depth = 4096;
+
+  Scheduler(std::size_t = default_slice, std::size_t = default_stack);
+
+  static Limits default_limits();
+
+  Task& spawn(Function_decl const*, Limits const& = default_limits());
+  void run(std::size_t);
+
+  std::vector<std::unique_ptr<Task>> const& tasks() const { return tasks_; }
+
+private:
+  void work();
+
+  std::size_t slice_;  // Fuel per time slice
+  std::size_t stack_;  // Bytes per task stack
+
+  std::vector<std::unique_ptr<Task>> tasks_;
+  std::deque<Task*>                  ready_;
+  std::size_t                        pending_ = 0;  // Tasks not yet done
+  std::mutex                         mutex_;
+  std::condition_variable            cv_;
+};
+
+
+#endif
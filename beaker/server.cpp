@@ -0,0 +1,229 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "server.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+// Run the program in a child process whose request is
+// read from the file descriptor in, and exit with its
+// status. The request replaces the standard input. The
+// server never reads through the standard input stream,
+// so the child inherits no buffered input.
+[[noreturn]] void
+run_child(int in, std::function<void()> const& fn)
+{
+  signal(SIGPIPE, SIG_DFL);
+  dup2(in, STDIN_FILENO);
+  close(in);
+
+  int status = 0;
+  try {
+    fn();
+  } catch (Translation_error& err) {
+    diagnose(err);
+    status = 1;
+  } catch (std::exception& err) {
+    std::cerr << "error: " << err.what() << '\n';
+    status = 1;
+  }
+  std::cout.flush();
+  std::cerr.flush();
+  _exit(status);
+}
+
+
+// Fork a child to run the program. Output buffered by
+// the server is flushed first so that it is not written
+// again by the child.
+pid_t
+fork_child()
+{
+  std::cout.flush();
+  std::cerr.flush();
+  pid_t pid = fork();
+  if (pid < 0)
+    std::cerr << "error: fork: " << std::strerror(errno) << '\n';
+  return pid;
+}
+
+
+// Write the n bytes at p to the file descriptor fd.
+// Returns false if the reader has gone away.
+bool
+write_all(int fd, char const* p, std::size_t n)
+{
+  while (n) {
+    ssize_t k = write(fd, p, n);
+    if (k < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    p += k;
+    n -= k;
+  }
+  return true;
+}
+
+
+// Read the next line of the file descriptor fd into line,
+// without its newline. Input read past the line is kept
+// in buf. Returns false at the end of the input.
+bool
+read_line(int fd, std::string& buf, std::string& line)
+{
+  while (true) {
+    std::size_t n = buf.find('\n');
+    if (n != std::string::npos) {
+      line.assign(buf, 0, n);
+      buf.erase(0, n + 1);
+      return true;
+    }
+    char chunk[4096];
+    ssize_t k = read(fd, chunk, sizeof(chunk));
+    if (k < 0 && errno == EINTR)
+      continue;
+    if (k <= 0) {
+      line.swap(buf);
+      buf.clear();
+      return !line.empty();
+    }
+    buf.append(chunk, k);
+  }
+}
+
+
+// Serve a request for each line of the standard input.
+// The line is written to a pipe that is the child's
+// standard input. A child that exits without reading
+// all of its request does not stop the server.
+bool
+serve_pipe(std::function<void()> const& fn)
+{
+  signal(SIGPIPE, SIG_IGN);
+  std::string buf;
+  std::string line;
+  while (read_line(STDIN_FILENO, buf, line)) {
+    int fds[2];
+    if (pipe(fds)) {
+      std::cerr << "error: pipe: " << std::strerror(errno) << '\n';
+      return false;
+    }
+    pid_t pid = fork_child();
+    if (pid < 0)
+      return false;
+    if (pid == 0) {
+      close(fds[1]);
+      run_child(fds[0], fn);
+    }
+    close(fds[0]);
+    line += '\n';
+    write_all(fds[1], line.data(), line.size());
+    close(fds[1]);
+    int status;
+    waitpid(pid, &status, 0);
+  }
+  return true;
+}
+
+
+// Serve a request for each connection to the socket
+// at path. The connection is the child's standard input,
+// output, and error. At most jobs children run at once;
+// further connections wait in the socket's backlog.
+bool
+serve_socket(char const* path, std::size_t jobs, std::function<void()> const& fn)
+{
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (std::strlen(path) >= sizeof(addr.sun_path)) {
+    std::cerr << "error: socket path '" << path << "' is too long\n";
+    return false;
+  }
+  std::strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    std::cerr << "error: socket: " << std::strerror(errno) << '\n';
+    return false;
+  }
+  unlink(path);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) || listen(fd, SOMAXCONN)) {
+    std::cerr << "error: cannot listen on '" << path << "': "
+              << std::strerror(errno) << '\n';
+    close(fd);
+    return false;
+  }
+
+  std::size_t running = 0;
+  while (true) {
+    // Reap finished children, and wait for one to finish
+    // if too many are running.
+    while (running) {
+      int status;
+      pid_t pid = waitpid(-1, &status, running < jobs ? WNOHANG : 0);
+      if (pid > 0)
+        --running;
+      else if (pid == 0 || errno != EINTR)
+        break;
+    }
+
+    int conn = accept(fd, nullptr, nullptr);
+    if (conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      std::cerr << "error: accept: " << std::strerror(errno) << '\n';
+      close(fd);
+      return false;
+    }
+    pid_t pid = fork_child();
+    if (pid == 0) {
+      close(fd);
+      dup2(conn, STDOUT_FILENO);
+      dup2(conn, STDERR_FILENO);
+      run_child(conn, fn);
+    }
+    if (pid > 0)
+      ++running;
+    close(conn);
+  }
+}
+
+} // namespace
+
+
+// Serve requests to run fn, received at the path. A socket
+// server runs at most jobs requests at once, or one per
+// processor if jobs is 0. Returns false if the server cannot
+// be started. Otherwise, when serving the standard input,
+// returns true at the end of the input. A socket server
+// does not return.
+bool
+serve(char const* path, std::size_t jobs, std::function<void()> const& fn)
+{
+  if (!jobs)
+    jobs = std::max(1u, std::thread::hardware_concurrency());
+  if (!std::strcmp(path, "-"))
+    return serve_pipe(fn);
+  else
+    return serve_socket(path, jobs, fn);
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_SERVER_HPP
+#define BEAKER_SERVER_HPP
+
+// A fork server runs a translated program on request.
+//
+// The server is started once the program has been
+// elaborated. For each request, it forks a child process
+// that evaluates the program. The child shares the parent's
+// symbols, syntax trees, and types copy-on-write, so the
+// cost of starting a run is the cost of fork.
+//
+// Requests are received in one of two ways:
+//
+//    - on a Unix socket, where each connection is a request.
+//      The connection is the child's standard input, output
+//      and error, and is closed when the run ends. Runs
+//      proceed concurrently, up to a limit (-fserver-jobs).
+//
+//    - on the standard input ("-"), where each line is a
+//      request. The line is the child's standard input, and
+//      the child writes to the server's standard output and
+//      error. Runs proceed one at a time, in order.
+//
+// So the same program can be run against many inputs. The
+// child never sees the input of another request.
+
+#include <cstddef>
+#include <functional>
+
+
+bool serve(char const*, std::size_t, std::function<void()> const&);
+
+
+#endif
@@ -0,0 +1,376 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "snapshot.hpp"
+#include "decl.hpp"
+#include "file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <unistd.h>
+
+
+namespace
+{
+
+char const magic[8] = {'B', 'K', 'R', 'S', 'N', 'A', 'P', '\0'};
+
+
+// The identity of a source file: its size and an FNV-1a
+// hash of its contents.
+struct Fingerprint
+{
+  std::uint64_t size = 0;
+  std::uint64_t hash = 14695981039346656037ull;
+};
+
+
+Fingerprint
+fingerprint(File const& f)
+{
+  Fingerprint fp;
+  std::ifstream is(f.path().c_str(), std::ios::binary);
+  char buf[4096];
+  while (is.read(buf, sizeof(buf)) || is.gcount()) {
+    std::streamsize n = is.gcount();
+    for (std::streamsize i = 0; i < n; ++i) {
+      fp.hash ^= (unsigned char)buf[i];
+      fp.hash *= 1099511628211ull;
+    }
+    fp.size += n;
+  }
+  return fp;
+}
+
+
+// Returns the global variables of the module, in
+// declaration order.
+std::vector<Variable_decl const*>
+variables(Module_decl const* m)
+{
+  std::vector<Variable_decl const*> vars;
+  for (Decl const* d : m->declarations()) {
+    if (Variable_decl const* v = as<Variable_decl>(d))
+      vars.push_back(v);
+  }
+  return vars;
+}
+
+
+// Returns the values in the value v, in pre-order.
+void
+walk(Value& v, std::vector<Value*>& vs)
+{
+  vs.push_back(&v);
+  if (v.is_array() || v.is_tuple()) {
+    Aggregate_value a = v.is_array() ? Aggregate_value(v.r.arr_) : v.r.tup_;
+    for (std::size_t i = 0; i < a.len; ++i)
+      walk(a.data[i], vs);
+  }
+}
+
+
+// The snapshot writer.
+//
+// Integers are written in the native byte order. The
+// snapshot is a cache of local state, not an interchange
+// format.
+struct Writer
+{
+  void put(std::uint64_t n)
+  {
+    os.write((char const*)&n, sizeof(n));
+  }
+
+  void put(String const& s)
+  {
+    put(s.size());
+    os.write(s.data(), s.size());
+  }
+
+  void put(Value const& v)
+  {
+    os.put(char(v.kind()));
+    switch (v.kind()) {
+      case error_value:
+        break;
+      case integer_value:
+        put(std::uint64_t(std::int64_t(v.get_integer())));
+        break;
+      case function_value:
+        put(position(fns, v.get_function(), "function"));
+        break;
+      case reference_value:
+        put(position(ids, v.get_reference(), "reference"));
+        break;
+      case array_value:
+        put(v.r.arr_);
+        break;
+      case tuple_value:
+        put(v.r.tup_);
+        break;
+    }
+  }
+
+  void put(Aggregate_value const& a)
+  {
+    put(a.len);
+    for (std::size_t i = 0; i < a.len; ++i)
+      put(a.data[i]);
+  }
+
+  // Returns 1 plus the position of p, 0 if p is null.
+  template<typename M, typename T>
+  std::uint64_t
+  position(M const& m, T const* p, char const* what)
+  {
+    if (!p)
+      return 0;
+    auto iter = m.find(p);
+    if (iter == m.end())
+      throw std::runtime_error(String("cannot record ") + what + " value");
+    return iter->second + 1;
+  }
+
+  std::ostream& os;
+  std::unordered_map<Decl const*, std::uint64_t>  fns;  // Module positions
+  std::unordered_map<Value const*, std::uint64_t> ids;  // Pre-order positions
+};
+
+
+// The snapshot reader. Since each value takes at least one
+// byte of the file, the number of values is bounded by the
+// size of the file, so that a corrupt snapshot cannot cause
+// a huge allocation. Aggregates take their memory from the
+// remaining heap, and their nesting is bounded so that a
+// corrupt snapshot cannot exhaust the stack.
+struct Reader
+{
+  static constexpr int max_depth = 256;
+
+  std::uint64_t get()
+  {
+    std::uint64_t n;
+    if (!is.read((char*)&n, sizeof(n)))
+      throw std::runtime_error("truncated");
+    return n;
+  }
+
+  std::uint64_t get_length()
+  {
+    std::uint64_t n = get();
+    if (n > size)
+      throw std::runtime_error("invalid length");
+    return n;
+  }
+
+  String get_string()
+  {
+    String s(get_length(), 0);
+    if (!is.read(&s[0], s.size()))
+      throw std::runtime_error("truncated");
+    return s;
+  }
+
+  // Returns the length of an aggregate, taking the memory
+  // of its elements.
+  std::uint64_t get_elements()
+  {
+    std::uint64_t n = get();
+    if (n > size - values)
+      throw std::runtime_error("invalid length");
+    if (n > heap / sizeof(Value))
+      throw std::runtime_error("heap limit exceeded");
+    values += n;
+    heap -= n * sizeof(Value);
+    return n;
+  }
+
+  Value get_value(int depth = 0)
+  {
+    if (depth > max_depth)
+      throw std::runtime_error("values nested too deeply");
+    std::uint64_t self = count++;
+    int k = is.get();
+    kinds.push_back(k);
+    switch (k) {
+      case error_value:
+        return Value();
+      case integer_value:
+        return Integer_value(std::int64_t(get()));
+      case function_value: {
+        std::uint64_t n = get();
+        if (n > decls.size())
+          throw std::runtime_error("invalid function");
+        Function_decl const* f = n ? as<Function_decl>(decls[n - 1]) : nullptr;
+        if (n && !f)
+          throw std::runtime_error("invalid function");
+        return f;
+      }
+      case reference_value: {
+        // The referent is resolved once all variables
+        // have been bound.
+        std::uint64_t n = get();
+        if (n)
+          refs.emplace_back(self, n - 1);
+        Value v;
+        v.k = reference_value;
+        v.r.ref_ = nullptr;
+        return v;
+      }
+      case array_value: {
+        Array_value a(get_elements());
+        for (std::size_t i = 0; i < a.len; ++i)
+          a.data[i] = get_value(depth + 1);
+        return a;
+      }
+      case tuple_value: {
+        Tuple_value t(get_elements());
+        for (std::size_t i = 0; i < t.len; ++i)
+          t.data[i] = get_value(depth + 1);
+        return t;
+      }
+      default:
+        throw std::runtime_error("invalid value");
+    }
+  }
+
+  std::istream&   is;
+  std::uint64_t   size;
+  Decl_seq const& decls;
+  std::size_t     heap;       // Remaining heap bytes
+  std::uint64_t   count = 0;  // Values read
+  std::uint64_t   values = 0; // Aggregate elements read
+  std::vector<int> kinds;     // The kind of each value read
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> refs;  // References to patch
+};
+
+} // namespace
+
+
+// Write a snapshot of the global variables of the module m,
+// bound in the store s, to the file at path. The source file
+// of the program is src. The snapshot is written to a
+// temporary file, named for this process, and renamed to
+// path when complete. Returns false, after diagnosing the
+// problem, if the snapshot cannot be written.
+bool
+write_snapshot(char const* path, File const& src, Module_decl const* m, Store const& s)
+{
+  String tmp = String(path) + ".tmp." + std::to_string(getpid());
+  std::ofstream os(tmp, std::ios::binary);
+  if (!os) {
+    std::cerr << "error: cannot write snapshot '" << path << "'\n";
+    return false;
+  }
+
+  Writer w{os};
+  Decl_seq const& ds = m->declarations();
+  for (std::size_t i = 0; i < ds.size(); ++i)
+    w.fns.emplace(ds[i], i);
+
+  // Number the values of all variables so that references
+  // between them can be recorded.
+  std::vector<Variable_decl const*> vars = variables(m);
+  std::vector<Value*> vs;
+  for (Variable_decl const* v : vars) {
+    Store::Binding const* b = s.lookup(v->name());
+    if (!b) {
+      std::cerr << "error: variable '" << *v->name() << "' is not initialized\n";
+      os.close();
+      std::remove(tmp.c_str());
+      return false;
+    }
+    walk(const_cast<Value&>(b->second), vs);
+  }
+  for (std::size_t i = 0; i < vs.size(); ++i)
+    w.ids.emplace(vs[i], i);
+
+  Fingerprint fp = fingerprint(src);
+  os.write(magic, sizeof(magic));
+  w.put(snapshot_version);
+  w.put(fp.size);
+  w.put(fp.hash);
+  w.put(vars.size());
+  try {
+    for (Variable_decl const* v : vars) {
+      w.put(v->name()->spelling());
+      w.put(s.lookup(v->name())->second);
+    }
+  } catch (std::runtime_error& err) {
+    std::cerr << "error: snapshot '" << path << "': " << err.what() << '\n';
+    os.close();
+    std::remove(tmp.c_str());
+    return false;
+  }
+  os.close();
+  if (!os || std::rename(tmp.c_str(), path)) {
+    std::cerr << "error: cannot write snapshot '" << path << "'\n";
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+// Restore the global variables of the module m into the
+// store s from the snapshot at path, which must have been
+// taken for the source file src. The restored values take
+// their memory from the remaining heap. Returns false if
+// the file does not exist, or does not match the program.
+// Nothing is bound unless the whole snapshot is valid.
+bool
+read_snapshot(char const* path, File const& src, Module_decl const* m, Store& s, std::size_t& heap)
+{
+  std::ifstream is(path, std::ios::binary | std::ios::ate);
+  if (!is)
+    return false;
+  std::uint64_t size = is.tellg();
+  is.seekg(0);
+
+  Reader r{is, size, m->declarations(), heap};
+  std::vector<Variable_decl const*> vars = variables(m);
+  Value_seq vals;
+  try {
+    char buf[sizeof(magic)];
+    if (!is.read(buf, sizeof(buf)) || std::memcmp(buf, magic, sizeof(magic)))
+      throw std::runtime_error("not a snapshot");
+    if (r.get() != snapshot_version)
+      throw std::runtime_error("wrong version");
+    Fingerprint fp = fingerprint(src);
+    std::uint64_t n = r.get();
+    std::uint64_t h = r.get();
+    if (n != fp.size || h != fp.hash)
+      throw std::runtime_error("source has changed");
+    if (r.get() != vars.size())
+      throw std::runtime_error("variables have changed");
+    for (Variable_decl const* v : vars) {
+      if (r.get_string() != v->name()->spelling())
+        throw std::runtime_error("variables have changed");
+      vals.push_back(r.get_value());
+    }
+    for (auto const& x : r.refs) {
+      if (x.second >= r.count || r.kinds[x.second] == reference_value)
+        throw std::runtime_error("invalid reference");
+    }
+  } catch (std::runtime_error& err) {
+    std::cerr << "note: snapshot '" << path << "' is out of date ("
+              << err.what() << ")\n";
+    return false;
+  }
+
+  // Bind the variables, and then resolve references to
+  // the values in their final locations.
+  heap = r.heap;
+  std::vector<Value*> vs;
+  for (std::size_t i = 0; i < vars.size(); ++i)
+    walk(s.bind(vars[i]->name(), vals[i]).second, vs);
+  for (auto const& x : r.refs)
+    *vs[x.first] = Value(vs[x.second]);
+  return true;
+}
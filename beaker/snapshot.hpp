@@ -0,0 +1,46 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_SNAPSHOT_HPP
+#define BEAKER_SNAPSHOT_HPP
+
+// A snapshot records the initialized global variables of a
+// program, so that a later run can restore them instead of
+// evaluating their initializers.
+//
+// The snapshot is a binary file containing:
+//
+//    - a header with a magic number and the format version,
+//    - the size and a hash of the program's source text,
+//    - the name and value of each global variable, in
+//      declaration order.
+//
+// A snapshot is only restored if its version, source size
+// and hash, and variable names all match the program. The
+// functions of the program are not recorded; they are bound
+// by the evaluator as usual.
+//
+// Function values are recorded as the position of their
+// declaration in the module, and references as the position
+// of their referent in a pre-order walk of the variables.
+//
+// A snapshot is written to a temporary file that is renamed
+// over the old one, so that readers never see a partial
+// snapshot.
+
+#include "evaluator.hpp"
+
+#include <cstdint>
+
+
+class File;
+
+
+constexpr std::uint32_t snapshot_version = 1;
+
+
+bool write_snapshot(char const*, File const&, Module_decl const*, Store const&);
+bool read_snapshot(char const*, File const&, Module_decl const*, Store&, std::size_t&);
+
+
+#endif
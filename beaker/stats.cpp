@@ -0,0 +1,174 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#if defined(__GNUG__)
+#  include <cxxabi.h>
+#endif
+
+
+namespace
+{
+
+// Registers the shard of a thread on its first increment,
+// and retires it when the thread exits.
+struct Shard_owner
+{
+  Shard_owner()
+  {
+    for (std::atomic<std::uint64_t>& x : shard.n)
+      x.store(0, std::memory_order_relaxed);
+    stats().attach(&shard);
+  }
+
+  ~Shard_owner() { stats().detach(&shard); }
+
+  Counter_shard shard;
+};
+
+} // namespace
+
+
+Counter_shard&
+counter_shard()
+{
+  thread_local Shard_owner s;
+  return s.shard;
+}
+
+
+// Initialize the counter and register it.
+Counter::Counter(String const& n, char const* d)
+  : name_(n), desc_(d), n_(0)
+{
+  stats().add(this);
+}
+
+
+std::uint64_t
+Counter::value() const
+{
+  return stats().value(*this);
+}
+
+
+// Register the counter, giving it the next index in
+// the shards.
+void
+Stats_registry::add(Counter* c)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  c->id_ = counters_.size();
+  counters_.push_back(c);
+}
+
+
+void
+Stats_registry::attach(Counter_shard* s)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  shards_.push_back(s);
+}
+
+
+// Add the counts of an exiting thread to the counters,
+// and forget its shard.
+void
+Stats_registry::detach(Counter_shard* s)
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (Counter* c : counters_) {
+    if (c->id_ < Counter_shard::size)
+      c->n_.fetch_add(s->n[c->id_].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  shards_.erase(std::find(shards_.begin(), shards_.end(), s));
+}
+
+
+// Returns the value of c: the counts of the exited
+// threads, and those of the running threads.
+std::uint64_t
+Stats_registry::value(Counter const& c) const
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::uint64_t n = c.n_.load(std::memory_order_relaxed);
+  if (c.id_ < Counter_shard::size) {
+    for (Counter_shard const* s : shards_)
+      n += s->n[c.id_].load(std::memory_order_relaxed);
+  }
+  return n;
+}
+
+
+// Returns the counters, ordered by name.
+std::vector<Counter const*>
+Stats_registry::sorted() const
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::vector<Counter const*> v(counters_.begin(), counters_.end());
+  std::sort(v.begin(), v.end(), [](Counter const* a, Counter const* b) {
+    return a->name() < b->name();
+  });
+  return v;
+}
+
+
+// Print the counters as a table.
+void
+Stats_registry::print(std::ostream& os) const
+{
+  for (Counter const* c : sorted()) {
+    os << std::setw(12) << c->value() << "  "
+       << std::left << std::setw(28) << c->name() << std::right
+       << "  " << c->description() << '\n';
+  }
+}
+
+
+// Print the counters as a JSON object mapping
+// names to values.
+void
+Stats_registry::print_json(std::ostream& os) const
+{
+  std::vector<Counter const*> v = sorted();
+  os << "{\n";
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    os << "  \"" << v[i]->name() << "\": " << v[i]->value();
+    if (i + 1 != v.size())
+      os << ',';
+    os << '\n';
+  }
+  os << "}\n";
+}
+
+
+// Returns the global counter registry.
+Stats_registry&
+stats()
+{
+  static Stats_registry r;
+  return r;
+}
+
+
+// Returns the unqualified, demangled name of a type.
+String
+type_name(std::type_info const& t)
+{
+#if defined(__GNUG__)
+  int status;
+  char* p = abi::__cxa_demangle(t.name(), nullptr, nullptr, &status);
+  if (status == 0) {
+    String s = p;
+    std::free(p);
+    return s;
+  }
+#endif
+  return t.name();
+}
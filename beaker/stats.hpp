@@ -0,0 +1,126 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_STATS_HPP
+#define BEAKER_STATS_HPP
+
+// The stats module supports the --stats option. It provides
+// a registry of named counters. Modules declare counters as
+// static objects, which register themselves on construction,
+// and increment them as work is done.
+//
+// Counters are always on, so an increment must be cheap,
+// even when threads share a counter. Each thread counts in
+// its own shard, with a relaxed load and store rather than
+// a locked add, and the value of a counter is the sum of
+// the shards. When a thread exits, its counts are added to
+// the counters. Counts are exact for any number of threads.
+
+#include "string.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
+
+// The counts of one thread, indexed by counter. Only the
+// thread writes its shard, but the shard is read by other
+// threads when counters are printed.
+struct Counter_shard
+{
+  static constexpr std::uint32_t size = 512;
+
+  std::atomic<std::uint64_t> n[size];
+};
+
+
+// Returns the shard of the calling thread. This is not
+// inline, so that the shard is found again on each call:
+// a task can be resumed by a different thread.
+Counter_shard& counter_shard();
+
+
+// A named counter.
+class Counter
+{
+public:
+  Counter(String const&, char const*);
+
+  Counter(Counter const&) = delete;
+  Counter& operator=(Counter const&) = delete;
+
+  void operator++() { *this += 1; }
+  void operator+=(std::uint64_t);
+
+  String const& name() const        { return name_; }
+  char const*   description() const { return desc_; }
+  std::uint64_t value() const;
+
+private:
+  friend class Stats_registry;
+
+  String                     name_;
+  char const*                desc_;
+  std::uint32_t              id_;  // The index in each shard
+  std::atomic<std::uint64_t> n_;   // Counts of exited threads
+};
+
+
+// Add k to the counter. Counters registered after the
+// shards are full are incremented by a locked add.
+inline void
+Counter::operator+=(std::uint64_t k)
+{
+  if (id_ < Counter_shard::size) {
+    std::atomic<std::uint64_t>& x = counter_shard().n[id_];
+    x.store(x.load(std::memory_order_relaxed) + k, std::memory_order_relaxed);
+  } else {
+    n_.fetch_add(k, std::memory_order_relaxed);
+  }
+}
+
+
+// The registry maintains the list of all counters, and
+// the shards of the running threads.
+class Stats_registry
+{
+public:
+  void add(Counter*);
+
+  void attach(Counter_shard*);
+  void detach(Counter_shard*);
+
+  std::uint64_t value(Counter const&) const;
+
+  void print(std::ostream&) const;
+  void print_json(std::ostream&) const;
+
+private:
+  std::vector<Counter const*> sorted() const;
+
+  mutable std::mutex          mtx_;
+  std::vector<Counter*>       counters_;
+  std::vector<Counter_shard*> shards_;
+};
+
+
+Stats_registry& stats();
+
+String type_name(std::type_info const&);
+
+
+// Returns the counter for AST nodes of type T. The
+// counter is registered on first use.
+template<typename T>
+inline Counter&
+node_counter()
+{
+  static Counter c("ast." + type_name(typeid(T)), "AST nodes created");
+  return c;
+}
+
+
+#endif
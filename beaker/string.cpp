@@ -6,6 +6,11 @@
 #include <iostream>
 #include <iterator>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 
 using Iter = std::istreambuf_iterator<char>;
 
@@ -16,13 +21,79 @@ using Iter = std::istreambuf_iterator<char>;
 // Read the contents of the given input stream
 // into the string buffer.
 Stringbuf::Stringbuf(std::istream& is)
-  : buf_(Iter(is), Iter())
-{ }
+  : buf_(Iter(is), Iter()), map_(nullptr)
+{
+  reset();
+}
+
+
+// Take the contents of the buffer x. Note that the
+// characters of a short string move with it, but the
+// characters of a mapping or a view do not.
+Stringbuf::Stringbuf(Stringbuf&& x)
+  : buf_(std::move(x.buf_)), map_(x.map_)
+{
+  if (map_ || x.first_ != x.buf_.c_str()) {
+    first_ = x.first_;
+    last_ = x.last_;
+  } else {
+    reset();
+  }
+  x.map_ = nullptr;
+  x.buf_.clear();
+  x.reset();
+}
 
 
 void
 Stringbuf::assign(std::istream& is)
 { 
+  unmap();
   buf_.assign(Iter(is), Iter());
+  reset();
+}
+
+
+// Map the contents of the file at path into memory. The
+// kernel is advised that the mapping will be read once,
+// sequentially, so that it can read ahead. Returns false
+// if the file is not a regular, non-empty file, or cannot
+// be mapped.
+bool
+Stringbuf::map(char const* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return false;
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+  madvise(p, st.st_size, MADV_WILLNEED);
+
+  unmap();
+  buf_.clear();
+  map_ = p;
+  first_ = static_cast<char const*>(p);
+  last_ = first_ + st.st_size;
+  return true;
+}
+
+
+// Release the mapping, if any.
+void
+Stringbuf::unmap()
+{
+  if (map_) {
+    munmap(map_, last_ - first_);
+    map_ = nullptr;
+    reset();
+  }
 }
 
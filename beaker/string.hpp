@@ -5,12 +5,21 @@
 #define BEAKER_STRING_HPP
 
 #include <cctype>
+#include <cstdint>
 #include <cstring>
 #include <algorithm>
 #include <iosfwd>
 #include <string>
 #include <stdexcept>
 
+#include <boost/utility/string_ref.hpp>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 
 // -------------------------------------------------------------------------- //
 //                              Strings
@@ -121,108 +130,257 @@ string_to_int(String const& s, int b)
 
 
 // -------------------------------------------------------------------------- //
-//                          String builder
+//                          Character scanning
+//
+// The scanning functions find the end of a run of characters
+// in a class, examining 32 bytes at a time with AVX2 or 16
+// bytes at a time with SSE2, whichever the target supports.
+// Each function returns the first position in [first, last)
+// whose character is not in the class, or last. Positions too
+// close to last for a full vector are scanned one character
+// at a time.
+
+#if defined(__AVX2__)
+#  define BEAKER_SCAN_VECTOR 1
+using Char_vector = __m256i;
+
+inline Char_vector
+load_chars(char const* p)
+{
+  return _mm256_loadu_si256((__m256i const*)p);
+}
 
+// Returns a vector whose bytes are set where v is c.
+inline Char_vector
+match_char(Char_vector v, char c)
+{
+  return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
 
-// The string builder facilitates the caching of characters
-// needed to form a string during lexical analysis.
-//
-// TODO: Allow strings greater than 128 bytes in length.
-// Basically, this entails implementing the small-string 
-// optimization.
-class String_builder
+// Returns a vector whose bytes are set where v is in
+// [lo, hi]. Bytes outside ASCII compare as negative, so
+// they are never in a range of ASCII characters.
+inline Char_vector
+match_range(Char_vector v, char lo, char hi)
 {
-  static constexpr int init_size = 128;
-public:
-  String_builder();
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
 
-  String str() const;
-  String take();
+inline Char_vector
+either(Char_vector a, Char_vector b)
+{
+  return _mm256_or_si256(a, b);
+}
 
-  void put(char c);
-  void put(char const*);
-  void put(char const*, int n);
-  void put(char const*, char const*);
+inline Char_vector
+lower(Char_vector v)
+{
+  return _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+}
 
-  void clear();
-  
-private:
-  char buf_[init_size];
-  int  len_;
-};
+inline unsigned
+mask(Char_vector v)
+{
+  return _mm256_movemask_epi8(v);
+}
+#elif defined(__SSE2__)
+#  define BEAKER_SCAN_VECTOR 1
+using Char_vector = __m128i;
 
+inline Char_vector
+load_chars(char const* p)
+{
+  return _mm_loadu_si128((__m128i const*)p);
+}
 
-inline
-String_builder::String_builder()
-  : len_(0)
-{ 
-  std::fill(buf_, buf_ + init_size, 0);
+inline Char_vector
+match_char(Char_vector v, char c)
+{
+  return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+inline Char_vector
+match_range(Char_vector v, char lo, char hi)
+{
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
 }
 
+inline Char_vector
+either(Char_vector a, Char_vector b)
+{
+  return _mm_or_si128(a, b);
+}
 
-// FIXME: This should return a string view, but until
-// we can efficiently hash-compare a string view against
-// a string, it won't matter.
-inline String
-String_builder::str() const
+inline Char_vector
+lower(Char_vector v)
 {
-  return String(buf_, buf_ + len_);
+  return _mm_or_si128(v, _mm_set1_epi8(0x20));
 }
 
+inline unsigned
+mask(Char_vector v)
+{
+  return _mm_movemask_epi8(v);
+}
+#endif
 
-// Return the string in the builder and then reset it.
-inline String
-String_builder::take()
+
+// Returns the first position after a run of characters
+// satisfying the predicate p. When vectors are available,
+// vp returns a mask with the bits of matching characters
+// set for each vector of characters.
+template<typename P, typename V>
+inline char const*
+scan_while(char const* first, char const* last, P p, V vp)
 {
-  String s = str();
-  clear();
-  return s;
+#if BEAKER_SCAN_VECTOR
+  constexpr int n = sizeof(Char_vector);
+  constexpr unsigned all = unsigned((1ull << n) - 1);
+  while (last - first >= n) {
+    unsigned m = ~vp(load_chars(first)) & all;
+    if (m)
+      return first + __builtin_ctz(m);
+    first += n;
+  }
+#endif
+  while (first != last && p(*first))
+    ++first;
+  return first;
 }
 
 
-inline void
-String_builder::put(char c)
+#if BEAKER_SCAN_VECTOR
+inline unsigned
+match_space(Char_vector v)
 {
-  if (len_ == init_size)
-    throw std::runtime_error("string builder overflow");
-  buf_[len_++] = c;
+  return mask(either(either(match_char(v, ' '), match_char(v, '\t')),
+                     either(match_char(v, '\r'), match_char(v, '\v'))));
 }
 
 
-inline void
-String_builder::put(char const* s)
+inline unsigned
+match_whitespace(Char_vector v)
 {
-  put(s, std::strlen(s));
+  return match_space(v) | mask(match_char(v, '\n'));
 }
 
 
-inline void
-String_builder::put(char const* s, int n)
+inline unsigned
+match_alnum(Char_vector v)
 {
-  if (len_ + n >= init_size)
-    throw std::runtime_error("string builder overflow");
-  std::copy_n(s, n, buf_ + len_);
-  len_ += n;
+  return mask(either(match_range(lower(v), 'a', 'z'),
+                     match_range(v, '0', '9')));
 }
 
 
-inline void
-String_builder::put(char const* first, char const* last)
+inline unsigned
+match_not_newline(Char_vector v)
 {
-  put(first, last - first);
+  return ~mask(match_char(v, '\n'));
 }
+#else
+// Placeholders for the vector predicates.
+inline unsigned match_space(int) { return 0; }
+inline unsigned match_whitespace(int) { return 0; }
+inline unsigned match_alnum(int) { return 0; }
+inline unsigned match_not_newline(int) { return 0; }
+#endif
 
 
-// Reset the string builder so that it's content
-// is empty. 
-inline void
-String_builder::clear()
+inline bool
+is_whitespace(char c)
+{
+  return is_space(c) || is_newline(c);
+}
+
+
+inline bool
+is_alnum(char c)
+{
+  return std::isalpha(c) || std::isdigit(c);
+}
+
+
+inline bool
+is_not_newline(char c)
+{
+  return c != '\n';
+}
+
+
+// Returns the end of a run of horizontal and vertical
+// whitespace.
+inline char const*
+scan_whitespace(char const* first, char const* last)
 {
-  std::fill(buf_, buf_ + init_size, 0);
-  len_ = 0;
+  return scan_while(first, last, is_whitespace, match_whitespace);
 }
 
 
+// Returns the end of a run of letters and digits.
+inline char const*
+scan_alnum(char const* first, char const* last)
+{
+  return scan_while(first, last, is_alnum, match_alnum);
+}
+
+
+// Returns the position of the next newline, or last.
+inline char const*
+scan_line(char const* first, char const* last)
+{
+  return scan_while(first, last, is_not_newline, match_not_newline);
+}
+
+
+// -------------------------------------------------------------------------- //
+//                          String references
+
+// A string reference denotes the characters [first, last)
+// of some other string, usually the input buffer, without
+// copying them. The referenced characters must outlive the
+// reference.
+using String_ref = boost::string_ref;
+
+
+// A hash function for string references, and for strings,
+// which convert implicitly. The characters are mixed into
+// the hash 8 at a time, and the result is finalized so
+// that every bit of the input affects the low bits of the
+// hash, which select the slot in a hash table.
+struct String_hash
+{
+  static std::uint64_t mix(std::uint64_t h, std::uint64_t w)
+  {
+    h = (h ^ w) * 0xff51afd7ed558ccdull;
+    return h ^ (h >> 32);
+  }
+
+  std::size_t operator()(String_ref s) const
+  {
+    char const* p = s.data();
+    std::size_t n = s.size();
+    std::uint64_t h = n * 0x9e3779b97f4a7c15ull;
+    for (; n >= 8; p += 8, n -= 8) {
+      std::uint64_t w;
+      std::memcpy(&w, p, 8);
+      h = mix(h, w);
+    }
+    if (n) {
+      std::uint64_t w = 0;
+      for (std::size_t i = 0; i < n; ++i)
+        w |= std::uint64_t((unsigned char)p[i]) << (8 * i);
+      h = mix(h, w);
+    }
+    h ^= h >> 29;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 32);
+  }
+};
+
+
 // -------------------------------------------------------------------------- //
 //                            String buffer
 
@@ -230,37 +388,91 @@ String_builder::clear()
 // The string buffer class provides implements a simple 
 // string-based buffer for a stream. The string must not 
 // have null characters.
+//
+// The contents of a regular file can be mapped into
+// memory instead of being read. The buffer then refers
+// directly to the mapping, and the file is never copied.
+// Files that cannot be mapped (e.g., pipes) are read.
 class Stringbuf
 {
 public:
-  Stringbuf() = default;
+  Stringbuf();
   Stringbuf(String const&);
   Stringbuf(std::istream& is);
+  Stringbuf(char const*, char const*);
+  Stringbuf(Stringbuf&&);
+  ~Stringbuf();
+
+  Stringbuf(Stringbuf const&) = delete;
+  Stringbuf& operator=(Stringbuf const&) = delete;
 
   void assign(std::istream& is);
+  bool map(char const*);
+
+  bool mapped() const { return map_; }
 
   char const* begin() const;
   char const* end() const;
 
 private:
-  String   buf_;
+  void reset();
+  void unmap();
+
+  String      buf_;
+  char const* first_; // The first character
+  char const* last_;  // Past the last character
+  void*       map_;   // The mapping, if any
 };
 
 
+inline
+Stringbuf::Stringbuf()
+  : map_(nullptr)
+{
+  reset();
+}
+
+
 // Initialize the sting buffer from a pre-existing
 // string. Note that this copies the string.
 inline
 Stringbuf::Stringbuf(String const& s)
-  : buf_(s)
+  : buf_(s), map_(nullptr)
+{
+  reset();
+}
+
+
+// Refer to the characters [first, last) of another
+// buffer, without copying them.
+inline
+Stringbuf::Stringbuf(char const* first, char const* last)
+  : first_(first), last_(last), map_(nullptr)
 { }
 
 
+inline
+Stringbuf::~Stringbuf()
+{
+  unmap();
+}
+
+
+// Refer to the contents of the string.
+inline void
+Stringbuf::reset()
+{
+  first_ = buf_.c_str();
+  last_ = first_ + buf_.size();
+}
+
+
 // Returns an iterator to the beginning of the string
 // buffer.
 inline char const* 
 Stringbuf::begin() const
 { 
-  return buf_.c_str(); 
+  return first_;
 }
 
 
@@ -268,7 +480,7 @@ Stringbuf::begin() const
 inline char const* 
 Stringbuf::end() const
 { 
-  return begin() + buf_.size(); 
+  return last_;
 }
 
 
@@ -4,8 +4,43 @@
 #include "symbol.hpp"
 
 
+Counter interned_symbols("symbols.interned", "symbols added to the symbol table");
+
+
 std::ostream&
 operator<<(std::ostream& os, Symbol const& sym)
 {
   return os << sym.spelling();
 }
+
+
+// -------------------------------------------------------------------------- //
+// Symbol table
+
+Symbol_table::Symbol_table()
+  : syms(reserved_symbols()), slots_(init_slots, Slot{0, nullptr}), reserved_(syms.size() - 1)
+{ }
+
+
+// Destroy the symbols owned by the table. Their storage
+// is released with the arena.
+Symbol_table::~Symbol_table()
+{
+  for (std::size_t i = reserved_ + 1; i < syms.size(); ++i)
+    syms[i]->~Symbol();
+}
+
+
+// Double the number of slots, reinserting each symbol
+// by its stored hash.
+void
+Symbol_table::grow()
+{
+  std::vector<Slot> slots(2 * slots_.size(), Slot{0, nullptr});
+  slots_.swap(slots);
+  for (Slot const& x : slots) {
+    if (x.sym)
+      *find(x.sym->spelling(), x.hash) = x;
+  }
+  memory_report().allocate<Slot>(slots_.size());
+}
@@ -5,11 +5,16 @@
 #define BEAKER_SYMBOL_HPP
 
 #include "string.hpp"
+#include "stats.hpp"
+#include "memory.hpp"
+#include "arena.hpp"
 
 #include "lingo/node.hpp"
 
-#include <unordered_map>
+#include <cstdint>
+#include <cstring>
 #include <typeinfo>
+#include <vector>
 
 
 // -------------------------------------------------------------------------- //
@@ -22,21 +27,25 @@
 // punctuators and operators.
 class Symbol
 {
-  friend struct Symbol_table;
+  friend class Symbol_table;
+  friend class Concurrent_symbol_table;
+  friend std::vector<Symbol*> const& reserved_symbols();
 
 public:
   Symbol(int k)
-    : str_(nullptr), tok_(k)
+    : tok_(k), id_(0)
   { }
 
   virtual ~Symbol() { }
 
-  String const& spelling() const { return *str_; }
+  String const& spelling() const { return str_; }
   int           token() const    { return tok_; }
+  std::uint32_t index() const    { return id_; }
 
 private:
-  String const* str_; // The textual representation
+  String        str_; // The textual representation
   int           tok_; // The associated token kind
+  std::uint32_t id_;  // The index in the symbol table
 };
 
 
@@ -64,98 +73,173 @@ struct Boolean_sym : Symbol
 };
 
 
-// Represents all integer symbols.
-//
-// TODO: Develop and use a good arbitrary precision
-// integer for this representation.
-//
-// TOOD: Track the integer base? Technically, that
-// can be inferred by the spelling, but it might be
-// useful to keep cached.
-struct Integer_sym : Symbol
-{
-  Integer_sym(int k, int n)
-    : Symbol(k), value_(n)
-  { }
+// Streaming
+std::ostream& operator<<(std::ostream&, Symbol const&);
 
-  int value() const { return value_; }
 
-  int value_;
+// -------------------------------------------------------------------------- //
+//                          Reserved symbols
+
+
+// The spelling and token kind of a reserved symbol.
+struct Reserved_word
+{
+  constexpr Reserved_word(char const* s, int k)
+    : str(s), len(0), tok(k)
+  {
+    while (s[len])
+      ++len;
+  }
+
+  char const* str;
+  std::size_t len;
+  int         tok;
 };
 
 
-// Character symbols are represented by their integer
-// encoding in the execution character set. That
-// defaults to extended ASCII. Note that this internall
-// represnted as a system integer for simplicity.
+// The reserved symbols are the punctuators, keywords and
+// reserved names of the language (see token.cpp). They are
+// distinguished by the first and last characters and the
+// length of their spelling. The hash multiplies those by a
+// seed and takes the high bits of the product as the slot
+// in the reserved table. The seed is chosen at compile time
+// so that the hash is perfect.
 //
-// TODO: Support wide character encoding in ISO 10646
-// (Unicode).
-//
-// TODO: Support configuration of the execution character
-// set.
-struct Character_sym : Symbol
-{
-  Character_sym(int k, int n)
-    : Symbol(k), value_(n)
-  { }
+// The reserved table maps each slot to the index of its
+// reserved symbol, or to 0 if the slot is empty.
+constexpr std::size_t reserved_slots = 256;
 
-  int value() const { return value_; }
 
-  int value_;
+struct Reserved_table
+{
+  std::uint8_t slot[reserved_slots];
 };
 
 
-// A string symbol contains the representation of the
-// string literal in the execution character set.
-//
-// TODO: Supporting wide string literals would effectively
-// require this to be a union of narrow and wide string
-// representations.
-struct String_sym : Symbol
+extern Reserved_word const  reserved_words[];
+extern Reserved_table const reserved_table;
+extern std::uint32_t const  reserved_seed;
+
+
+constexpr std::uint32_t
+reserved_key(char const* s, std::size_t n)
 {
-  String_sym(int k, String const& s)
-    : Symbol(k), value_(s)
-  { }
+  return (unsigned char)s[0] | (unsigned char)s[n - 1] << 8 | std::uint32_t(n) << 16;
+}
 
-  String const& value() const { return value_; }
 
-  String value_;
-};
+constexpr std::size_t
+reserved_hash(std::uint32_t seed, std::uint32_t key)
+{
+  return std::uint32_t(key * seed) >> 24;
+}
 
 
-// Streaming
-std::ostream& operator<<(std::ostream&, Symbol const&);
+// Returns the index of the reserved symbol with the
+// spelling s, or 0 if s is not reserved.
+inline std::uint32_t
+reserved_index(String_ref s)
+{
+  std::size_t n = s.size();
+  if (!n)
+    return 0;
+  std::uint32_t i = reserved_table.slot[reserved_hash(reserved_seed, reserved_key(s.data(), n))];
+  if (!i)
+    return 0;
+  Reserved_word const& w = reserved_words[i - 1];
+  if (w.len != n || std::memcmp(w.str, s.data(), n))
+    return 0;
+  return i;
+}
+
+
+// Returns the reserved symbols by index. The element at
+// index 0 is null.
+std::vector<Symbol*> const& reserved_symbols();
 
 
 // -------------------------------------------------------------------------- //
 //                           Symbol table
 
 
+extern Counter interned_symbols;
+
+
+// The largest index of a symbol. Tokens refer to their
+// symbols by a 24-bit index (see token.hpp).
+constexpr std::uint32_t max_symbols = (1u << 24) - 1;
+
+
 // The symbol table maintains a mapping of
 // unique string values to their corresponding
 // symbols.
-struct Symbol_table : std::unordered_map<std::string, Symbol*>
+//
+// The reserved symbols are shared by all tables, and
+// have the indexes 1 through the number of reserved
+// symbols, so they are found by their index without
+// probing the table. Other symbols are allocated in the
+// table's arena, and are numbered in the order they are
+// added. The index 0 denotes no symbol.
+//
+// Other symbols are found through an open addressing
+// table with linear probing. Each slot holds the hash of
+// its symbol's spelling, so probes compare spellings only
+// when the hashes are equal, and the table grows without
+// hashing any spelling again. The spellings are owned by
+// the symbols, so symbols can be found by a reference
+// to any other string (e.g., a lexeme in the input
+// buffer) without allocating a string for the lookup.
+class Symbol_table
 {
+public:
+  Symbol_table();
+  Symbol_table(Symbol_table const&) = delete;
+  Symbol_table& operator=(Symbol_table const&) = delete;
   ~Symbol_table();
 
   template<typename T, typename... Args>
-  Symbol* put(String const&, Args&&...);
+  Symbol* put(String_ref, Args&&...);
 
   template<typename T, typename... Args>
   Symbol* put(char const*, char const*, Args&&...);
 
-  Symbol const* get(String const&) const;
-  Symbol const* get(char const*) const;
+  Symbol const* get(String_ref) const;
+  Symbol const* symbol(std::uint32_t) const;
+
+  std::vector<Symbol*> syms; // Symbols by index
+
+private:
+  struct Slot
+  {
+    std::size_t hash;
+    Symbol*     sym;   // Null if the slot is empty
+  };
+
+  static constexpr std::size_t init_slots = 64;
+
+  Slot* find(String_ref, std::size_t) const;
+  void  grow();
+
+  Arena             arena_;     // Storage for symbols
+  std::vector<Slot> slots_;     // A power of 2 in size
+  std::uint32_t     reserved_;  // The number of reserved symbols
 };
 
 
-// Delete allocated resources.
-inline
-Symbol_table::~Symbol_table()
+// Returns the slot of the symbol with the spelling s,
+// whose hash is h, or the empty slot where that symbol
+// would be inserted.
+inline Symbol_table::Slot*
+Symbol_table::find(String_ref s, std::size_t h) const
 {
-  for (auto const& x : *this)
-    delete x.second;
+  std::size_t mask = slots_.size() - 1;
+  std::size_t i = h & mask;
+  while (true) {
+    Slot const& x = slots_[i];
+    if (!x.sym || (x.hash == h && x.sym->spelling() == s))
+      return const_cast<Slot*>(&x);
+    i = (i + 1) & mask;
+  }
 }
 
 
@@ -177,24 +261,35 @@ Symbol_table::~Symbol_table()
 // harder.
 template<typename T, typename... Args>
 Symbol*
-Symbol_table::put(String const& s, Args&&... args)
+Symbol_table::put(String_ref s, Args&&... args)
 {
-  auto x = emplace(s, nullptr);
-  auto iter = x.first;
-  Symbol*& sym = iter->second;
-  if (x.second) {
-    // Insertion succeeded, so create a new symbol
-    // and bind its string representation.
-    sym = new T(std::forward<Args>(args)...);
-    sym->str_ = &iter->first;
-  } else {
-    // Insertion did not succeed. Check that we have
-    // not redefined the symbol kind.
+  Symbol* sym = syms[reserved_index(s)];
+  std::size_t h = 0;
+  if (!sym) {
+    h = String_hash()(s);
+    sym = find(s, h)->sym;
+  }
+  if (sym) {
+    // The symbol exists. Check that we have not
+    // redefined the symbol kind.
     if (typeid(T) != typeid(*sym))
       throw std::runtime_error("redefinition of symbol");
+    return sym;
   }
-  return iter->second;
 
+  // Create a new symbol and copy its spelling.
+  if (syms.size() > max_symbols)
+    throw std::runtime_error("too many symbols");
+  if (2 * (syms.size() - reserved_ + 1) > slots_.size())
+    grow();
+  sym = arena_.make<T>(std::forward<Args>(args)...);
+  sym->str_.assign(s.begin(), s.end());
+  sym->id_ = syms.size();
+  syms.push_back(sym);
+  *find(s, h) = Slot{h, sym};
+  ++interned_symbols;
+  memory_report().allocate<T>();
+  return sym;
 }
 
 
@@ -204,33 +299,27 @@ template<typename T, typename... Args>
 inline Symbol*
 Symbol_table::put(char const* first, char const* last, Args&&... args)
 {
-  return this->template put<T>(String(first, last), std::forward<Args>(args)...);
+  return this->template put<T>(String_ref(first, last - first), std::forward<Args>(args)...);
 }
 
 
 // Returns the symbol with the given spelling or
 // nullptr if no such symbol exists.
 inline Symbol const*
-Symbol_table::get(String const& s) const
+Symbol_table::get(String_ref s) const
 {
-  auto iter = find(s);
-  if (iter != end())
-    return iter->second;
-  else
-    return nullptr;
+  if (std::uint32_t n = reserved_index(s))
+    return syms[n];
+  return find(s, String_hash()(s))->sym;
 }
 
 
-// Returns the symbol with the given spelling or
-// nullptr if no such symbol exists.
+// Returns the symbol with index n, or nullptr if n
+// is 0.
 inline Symbol const*
-Symbol_table::get(char const* s) const
+Symbol_table::symbol(std::uint32_t n) const
 {
-  auto iter = find(s);
-  if (iter != end())
-    return iter->second;
-  else
-    return nullptr;
+  return syms[n];
 }
 
 
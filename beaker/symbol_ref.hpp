@@ -0,0 +1,77 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_SYMBOL_REF_HPP
+#define BEAKER_SYMBOL_REF_HPP
+
+// A symbol table reference refers to either a Symbol_table
+// or a Concurrent_symbol_table. The lexer, parser, and tokens
+// refer to their symbols through a reference, so the front end
+// can intern into either table: the single-threaded table, or
+// one that is shared by several lexer and parser threads.
+//
+// Since there are only two kinds of table, the table is
+// selected by a test rather than a virtual call, so that the
+// operations of both tables are inlined into the lexer.
+
+#include "symbol.hpp"
+#include "concurrent_symbol.hpp"
+
+
+class Symbol_table_ref
+{
+public:
+  Symbol_table_ref(Symbol_table&);
+  Symbol_table_ref(Concurrent_symbol_table&);
+
+  template<typename T, typename... Args>
+  Symbol* put(String_ref, Args&&...) const;
+
+  Symbol const* get(String_ref) const;
+  Symbol const* symbol(std::uint32_t) const;
+
+  Concurrent_symbol_table* concurrent() const { return csyms_; }
+
+private:
+  Symbol_table*            syms_;   // The table, if not concurrent
+  Concurrent_symbol_table* csyms_;  // The concurrent table, if any
+};
+
+
+inline
+Symbol_table_ref::Symbol_table_ref(Symbol_table& s)
+  : syms_(&s), csyms_(nullptr)
+{ }
+
+
+inline
+Symbol_table_ref::Symbol_table_ref(Concurrent_symbol_table& s)
+  : syms_(nullptr), csyms_(&s)
+{ }
+
+
+template<typename T, typename... Args>
+inline Symbol*
+Symbol_table_ref::put(String_ref s, Args&&... args) const
+{
+  if (csyms_)
+    return csyms_->template put<T>(s, std::forward<Args>(args)...);
+  return syms_->template put<T>(s, std::forward<Args>(args)...);
+}
+
+
+inline Symbol const*
+Symbol_table_ref::get(String_ref s) const
+{
+  return csyms_ ? csyms_->get(s) : syms_->get(s);
+}
+
+
+inline Symbol const*
+Symbol_table_ref::symbol(std::uint32_t n) const
+{
+  return csyms_ ? csyms_->symbol(n) : syms_->symbol(n);
+}
+
+
+#endif
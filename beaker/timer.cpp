@@ -0,0 +1,167 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "timer.hpp"
+#include "decl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+
+// Returns the current wall-clock and processor times.
+Time_sample
+sample_time()
+{
+  using Clock = std::chrono::steady_clock;
+  std::chrono::duration<double> w = Clock::now().time_since_epoch();
+  double c = double(std::clock()) / CLOCKS_PER_SEC;
+  return {w.count(), c};
+}
+
+
+// Returns the global time report.
+Time_report&
+time_report()
+{
+  static Time_report r;
+  return r;
+}
+
+
+// Enter the region r. Returns true if this is the
+// outermost entry into that region, meaning that the
+// caller should time it.
+bool
+Time_report::enter(Time_region r)
+{
+  return active_[r]++ == 0;
+}
+
+
+// Leave the region r, accumulating the time spent
+// in the region.
+void
+Time_report::leave(Time_region r, Time_sample t)
+{
+  --active_[r];
+  Time_record& rec = regions_[r];
+  rec.time.wall += t.wall;
+  rec.time.cpu += t.cpu;
+  ++rec.count;
+}
+
+
+// Accumulate time spent translating the declaration d.
+void
+Time_report::add(Cost_table c, Decl const* d, Time_sample t)
+{
+  Time_record& rec = costs_[c][d];
+  rec.time.wall += t.wall;
+  rec.time.cpu += t.cpu;
+  ++rec.count;
+}
+
+
+// Returns the name of the region.
+char const*
+region_name(Time_region r)
+{
+  switch (r) {
+    case lexing_time: return "lexing";
+    case parsing_time: return "parsing";
+    case elaboration_time: return "elaboration";
+    case generation_time: return "code generation";
+    case evaluation_time: return "evaluation";
+    case interning_time: return "type interning";
+    case lookup_time: return "scope lookup";
+    case lowering_time: return "LLVM type lowering";
+    case printing_time: return "IR printing";
+    default: return "<unspecified>";
+  }
+}
+
+
+namespace
+{
+
+char const*
+table_name(Cost_table c)
+{
+  switch (c) {
+    case elaboration_cost: return "elaboration";
+    case generation_cost: return "code generation";
+    default: return "<unspecified>";
+  }
+}
+
+
+void
+print_row(std::ostream& os, String const& name, Time_record const& rec)
+{
+  os << "  " << std::left << std::setw(24) << name << std::right
+     << std::setw(12) << rec.time.wall
+     << std::setw(12) << rec.time.cpu
+     << std::setw(10) << rec.count << '\n';
+}
+
+
+void
+print_header(std::ostream& os, char const* title)
+{
+  os << title << '\n';
+  os << "  " << std::left << std::setw(24) << "name" << std::right
+     << std::setw(12) << "wall (s)"
+     << std::setw(12) << "cpu (s)"
+     << std::setw(10) << "count" << '\n';
+}
+
+} // namespace
+
+
+// Print the report. At most n functions are listed for
+// each cost table.
+void
+Time_report::print(std::ostream& os, std::size_t n) const
+{
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(6);
+
+  // Print phases, omitting those that did not run.
+  Time_record total;
+  print_header(os, "phases:");
+  for (int r = lexing_time; r <= evaluation_time; ++r) {
+    Time_record const& rec = regions_[r];
+    if (!rec.count)
+      continue;
+    print_row(os, region_name(Time_region(r)), rec);
+    total.time.wall += rec.time.wall;
+    total.time.cpu += rec.time.cpu;
+    ++total.count;
+  }
+  print_row(os, "total", total);
+
+  print_header(os, "sub-phases:");
+  for (int r = interning_time; r < num_time_regions; ++r)
+    print_row(os, region_name(Time_region(r)), regions_[r]);
+
+  // Rank functions by wall time.
+  using Entry = std::pair<Decl const*, Time_record>;
+  for (int c = 0; c < num_cost_tables; ++c) {
+    std::vector<Entry> v(costs_[c].begin(), costs_[c].end());
+    std::sort(v.begin(), v.end(), [](Entry const& a, Entry const& b) {
+      return a.second.time.wall > b.second.time.wall;
+    });
+    if (v.size() > n)
+      v.resize(n);
+
+    String title = String("top functions by ") + table_name(Cost_table(c)) + ':';
+    print_header(os, title.c_str());
+    for (Entry const& e : v)
+      print_row(os, e.first->name()->spelling(), e.second);
+  }
+
+  os.flags(flags);
+}
@@ -0,0 +1,185 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_TIMER_HPP
+#define BEAKER_TIMER_HPP
+
+// The timer module supports the -ftime-report option. It
+// accumulates the wall and processor time spent in each
+// phase of translation, in a number of finer-grained
+// regions within those phases, and in each function
+// during elaboration and code generation.
+//
+// Timing is disabled by default. When disabled, a timer
+// costs one test of a flag.
+
+#include <iosfwd>
+#include <unordered_map>
+#include <vector>
+
+
+struct Decl;
+
+
+// Wall-clock and processor time, in seconds. This is
+// used both for points in time and for durations.
+struct Time_sample
+{
+  double wall;
+  double cpu;
+};
+
+
+Time_sample sample_time();
+
+
+inline Time_sample
+operator-(Time_sample const& a, Time_sample const& b)
+{
+  return {a.wall - b.wall, a.cpu - b.cpu};
+}
+
+
+// The regions of translation that are timed. Phases are
+// run in sequence by the drivers. Sub-phases may occur
+// within any phase.
+enum Time_region
+{
+  // Phases
+  lexing_time,
+  parsing_time,
+  elaboration_time,
+  generation_time,
+  evaluation_time,
+
+  // Sub-phases
+  interning_time,  // Type canonicalization
+  lookup_time,     // Scope lookup during elaboration
+  lowering_time,   // Translation of types to LLVM types
+  printing_time,   // Writing LLVM IR
+
+  num_time_regions
+};
+
+
+char const* region_name(Time_region);
+
+
+// The functions whose costs are ranked in the report.
+enum Cost_table
+{
+  elaboration_cost,
+  generation_cost,
+
+  num_cost_tables
+};
+
+
+// Accumulated time for a region or function.
+struct Time_record
+{
+  Time_sample time = {0, 0};
+  std::size_t count = 0;
+};
+
+
+// The time report accumulates records for each region
+// and function.
+//
+// Note that region times are inclusive. Recursive entries
+// into a region are not timed separately; only the
+// outermost entry is recorded.
+class Time_report
+{
+public:
+  bool enabled() const { return on_; }
+  void enable()        { on_ = true; }
+
+  bool enter(Time_region);
+  void leave(Time_region, Time_sample);
+
+  void add(Cost_table, Decl const*, Time_sample);
+
+  void print(std::ostream&, std::size_t = 10) const;
+
+private:
+  bool        on_ = false;
+  int         active_[num_time_regions] = { };
+  Time_record regions_[num_time_regions];
+  std::unordered_map<Decl const*, Time_record> costs_[num_cost_tables];
+};
+
+
+Time_report& time_report();
+
+
+// An RAII class that times a region for the duration
+// of its lifetime, or until it is stopped.
+class Timer_sentinel
+{
+public:
+  Timer_sentinel(Time_region);
+  ~Timer_sentinel() { stop(); }
+
+  void stop();
+
+private:
+  Time_region region_;
+  bool        on_;
+  Time_sample start_{};
+};
+
+
+inline
+Timer_sentinel::Timer_sentinel(Time_region r)
+  : region_(r), on_(time_report().enabled() && time_report().enter(r))
+{
+  if (on_)
+    start_ = sample_time();
+}
+
+
+inline void
+Timer_sentinel::stop()
+{
+  if (on_) {
+    time_report().leave(region_, sample_time() - start_);
+    on_ = false;
+  }
+}
+
+
+// An RAII class that times the translation of a single
+// function declaration and records it in a cost table.
+class Cost_sentinel
+{
+public:
+  Cost_sentinel(Cost_table, Decl const*);
+  ~Cost_sentinel();
+
+private:
+  Cost_table  table_;
+  Decl const* decl_;
+  bool        on_;
+  Time_sample start_{};
+};
+
+
+inline
+Cost_sentinel::Cost_sentinel(Cost_table t, Decl const* d)
+  : table_(t), decl_(d), on_(time_report().enabled())
+{
+  if (on_)
+    start_ = sample_time();
+}
+
+
+inline
+Cost_sentinel::~Cost_sentinel()
+{
+  if (on_)
+    time_report().add(table_, decl_, sample_time() - start_);
+}
+
+
+#endif
@@ -4,6 +4,9 @@
 #include "token.hpp"
 
 
+Counter pooled_literals("literals.pooled", "literals added to the literal pool");
+
+
 // TODO: This could be unified with the token so
 // that I'd only have to write the spelling once.
 char const*
@@ -57,57 +60,195 @@ spelling(Token_kind k)
   }
 }
 
-// Initialize the symbols of the language.
+
+namespace
+{
+
+// Returns the length of the literal of kind k that starts
+// the text s. A quoted literal ends at its first unescaped
+// closing quote.
+std::size_t
+literal_length(int k, String_ref s)
+{
+  std::size_t n = 0;
+  if (k == integer_tok) {
+    while (n < s.size() && is_decimal_digit(s[n]))
+      ++n;
+    return n;
+  }
+  n = 1;
+  while (n < s.size() && s[n] != s[0])
+    n += s[n] == '\\' ? 2 : 1;
+  return std::min(n + 1, s.size());
+}
+
+} // namespace
+
+
+// Returns the spelling of the token. The spelling of a
+// literal is its text in the source, which is found by its
+// location. If the source is no longer available, the
+// spelling is formed from the literal's value.
+String
+Token::spelling(Symbol_table_ref syms, Literal_pool const& lits) const
+{
+  if (!is_literal())
+    return symbol(syms)->spelling();
+  String_ref s = source_map().text(location());
+  if (!s.empty())
+    return String(s.begin(), literal_length(kind_, s));
+  switch (kind_) {
+    case integer_tok: return std::to_string(integer_value(lits));
+    case character_tok: return String("'") + char(character_value()) + "'";
+    default: return '"' + string_value(lits) + '"';
+  }
+}
+
+
+// Double the capacity of the ring, moving its tokens
+// to the front of the new buffer.
 void
-init_symbols(Symbol_table& syms)
+Token_stream::grow()
 {
-  // Create the symbol table and install all of the
-  // default tokens.
-  syms.put<Symbol>("{", lbrace_tok);
-  syms.put<Symbol>("}", rbrace_tok);
-  syms.put<Symbol>("(", lparen_tok);
-  syms.put<Symbol>(")", rparen_tok);
-  syms.put<Symbol>("[", lbrack_tok);
-  syms.put<Symbol>("]", rbrack_tok);
-  syms.put<Symbol>("'", squote_tok);
-  syms.put<Symbol>("\"", dquote_tok);
-  syms.put<Symbol>(",", comma_tok);
-  syms.put<Symbol>(":", colon_tok);
-  syms.put<Symbol>(";", semicolon_tok);
-  syms.put<Symbol>(".", dot_tok);
-  syms.put<Symbol>("=", equal_tok);
-  syms.put<Symbol>("+", plus_tok);
-  syms.put<Symbol>("-", minus_tok);
-  syms.put<Symbol>("*", star_tok);
-  syms.put<Symbol>("/", slash_tok);
-  syms.put<Symbol>("%", percent_tok);
-  syms.put<Symbol>("==", eq_tok);
-  syms.put<Symbol>("!=", ne_tok);
-  syms.put<Symbol>("<", lt_tok);
-  syms.put<Symbol>(">", gt_tok);
-  syms.put<Symbol>("<=", le_tok);
-  syms.put<Symbol>(">=", ge_tok);
-  syms.put<Symbol>("&&", and_tok);
-  syms.put<Symbol>("||", or_tok);
-  syms.put<Symbol>("!", not_tok);
-  syms.put<Symbol>("->", arrow_tok);
+  std::size_t n = buf_.size();
+  std::vector<Token> buf(2 * n);
+  for (std::size_t i = 0; i < size_; ++i)
+    buf[i] = buf_[(first_ + i) & (n - 1)];
+  buf_.swap(buf);
+  first_ = 0;
+  memory_report().allocate<Token>(2 * n);
+}
+
+
+// -------------------------------------------------------------------------- //
+// Reserved symbols
+
+// The reserved symbols of the language, in index order.
+extern constexpr Reserved_word reserved_words[] = {
+  {"{", lbrace_tok},
+  {"}", rbrace_tok},
+  {"(", lparen_tok},
+  {")", rparen_tok},
+  {"[", lbrack_tok},
+  {"]", rbrack_tok},
+  {"'", squote_tok},
+  {"\"", dquote_tok},
+  {",", comma_tok},
+  {":", colon_tok},
+  {";", semicolon_tok},
+  {".", dot_tok},
+  {"=", equal_tok},
+  {"+", plus_tok},
+  {"-", minus_tok},
+  {"*", star_tok},
+  {"/", slash_tok},
+  {"%", percent_tok},
+  {"==", eq_tok},
+  {"!=", ne_tok},
+  {"<", lt_tok},
+  {">", gt_tok},
+  {"<=", le_tok},
+  {">=", ge_tok},
+  {"&&", and_tok},
+  {"||", or_tok},
+  {"!", not_tok},
+  {"->", arrow_tok},
 
   // Keywords
-  syms.put<Symbol>("bool", bool_kw);
-  syms.put<Symbol>("break", break_kw);
-  syms.put<Symbol>("char", char_kw);
-  syms.put<Symbol>("continue", continue_kw);
-  syms.put<Symbol>("def", def_kw);
-  syms.put<Symbol>("else", else_kw);
-  syms.put<Symbol>("foreign", foreign_kw);
-  syms.put<Symbol>("if", if_kw);
-  syms.put<Symbol>("int", int_kw);
-  syms.put<Symbol>("while", while_kw);
-  syms.put<Symbol>("return", return_kw);
-  syms.put<Symbol>("struct", struct_kw);
-  syms.put<Symbol>("var", var_kw);
+  {"bool", bool_kw},
+  {"break", break_kw},
+  {"char", char_kw},
+  {"continue", continue_kw},
+  {"def", def_kw},
+  {"else", else_kw},
+  {"foreign", foreign_kw},
+  {"if", if_kw},
+  {"int", int_kw},
+  {"while", while_kw},
+  {"return", return_kw},
+  {"struct", struct_kw},
+  {"var", var_kw},
 
   // Reserved names.
-  syms.put<Boolean_sym>("true", boolean_tok, true);
-  syms.put<Boolean_sym>("false", boolean_tok, false);
+  {"true", boolean_tok},
+  {"false", boolean_tok},
+};
+
+
+namespace
+{
+
+constexpr std::size_t num_reserved = sizeof(reserved_words) / sizeof(Reserved_word);
+
+static_assert(num_reserved < reserved_slots, "too many reserved words");
+
+
+// Returns true if no two reserved words have the same
+// hash for the given seed.
+constexpr bool
+is_perfect(std::uint32_t seed)
+{
+  bool used[reserved_slots] = { };
+  for (Reserved_word const& w : reserved_words) {
+    std::size_t h = reserved_hash(seed, reserved_key(w.str, w.len));
+    if (used[h])
+      return false;
+    used[h] = true;
+  }
+  return true;
+}
+
+
+// Returns the first odd seed, from an arbitrary start,
+// for which the hash is perfect.
+constexpr std::uint32_t
+find_seed()
+{
+  std::uint32_t seed = 0x9e3779b1;
+  while (!is_perfect(seed))
+    seed += 2;
+  return seed;
+}
+
+
+constexpr Reserved_table
+make_reserved_table(std::uint32_t seed)
+{
+  Reserved_table t { };
+  for (std::size_t i = 0; i < num_reserved; ++i) {
+    Reserved_word const& w = reserved_words[i];
+    t.slot[reserved_hash(seed, reserved_key(w.str, w.len))] = i + 1;
+  }
+  return t;
+}
+
+} // namespace
+
+
+extern constexpr std::uint32_t  reserved_seed = find_seed();
+extern constexpr Reserved_table reserved_table = make_reserved_table(reserved_seed);
+
+
+// Returns the reserved symbols, creating them the first
+// time they are needed. They live for the duration of
+// the program.
+std::vector<Symbol*> const&
+reserved_symbols()
+{
+  static std::vector<Symbol*> syms = []() {
+    static Arena arena;
+    std::vector<Symbol*> v(1, nullptr);
+    for (Reserved_word const& w : reserved_words) {
+      Symbol* sym;
+      if (w.tok == boolean_tok)
+        sym = arena.make<Boolean_sym>(w.tok, w.str[0] == 't');
+      else
+        sym = arena.make<Symbol>(w.tok);
+      sym->str_.assign(w.str, w.len);
+      sym->id_ = v.size();
+      v.push_back(sym);
+    }
+    return v;
+  }();
+  return syms;
 }
@@ -5,10 +5,11 @@
 #define BEAKER_TOKEN_HPP
 
 #include "prelude.hpp"
-#include "symbol.hpp"
+#include "symbol_ref.hpp"
 #include "location.hpp"
 
-#include <list>
+#include <stdexcept>
+#include <vector>
 
 
 // -------------------------------------------------------------------------- //
@@ -80,6 +81,108 @@ spelling(Token_kind k);
 
 
 
+// -------------------------------------------------------------------------- //
+//                            Literal pool
+
+extern Counter pooled_literals;
+
+
+// The literal pool holds the values of the literals of a
+// token stream that do not fit in a token. Literals are
+// not interned in the symbol table, so adding one never
+// requires a lookup. The pool is only needed until the
+// tokens are parsed, and its memory can be released then.
+//
+// The index of an integer literal token is its value if
+// that fits in 23 bits. Otherwise, the top bit of the index
+// is set, and the rest is the position of the value in the
+// pool. The index of a string literal token is the position
+// of its value in the pool. Character literals are not
+// pooled (see Token::character_value).
+//
+// A pool that holds literals only until they are copied
+// into another pool (e.g., by a parallel lexer) is not
+// counted, so that each literal is counted once.
+class Literal_pool
+{
+public:
+  static constexpr std::uint32_t pooled_flag = 1u << 23;
+
+  explicit Literal_pool(bool counted = true)
+    : counted_(counted)
+  { }
+
+  std::uint32_t put_integer(int);
+  std::uint32_t put_string(String&&);
+
+  int           integer(std::uint32_t) const;
+  String const& string(std::uint32_t) const;
+
+  void clear();
+
+private:
+  std::vector<int>    ints_;
+  std::vector<String> strs_;
+  bool                counted_;
+};
+
+
+// Returns the index of an integer literal with value n.
+inline std::uint32_t
+Literal_pool::put_integer(int n)
+{
+  if (n >= 0 && std::uint32_t(n) < pooled_flag)
+    return n;
+  if (ints_.size() >= pooled_flag)
+    throw std::runtime_error("too many literals");
+  ints_.push_back(n);
+  if (counted_)
+    ++pooled_literals;
+  return pooled_flag | (ints_.size() - 1);
+}
+
+
+// Returns the index of a string literal with value s.
+inline std::uint32_t
+Literal_pool::put_string(String&& s)
+{
+  if (strs_.size() > (1u << 24) - 1)
+    throw std::runtime_error("too many literals");
+  strs_.push_back(std::move(s));
+  if (counted_)
+    ++pooled_literals;
+  return strs_.size() - 1;
+}
+
+
+// Returns the value of the integer literal with index n.
+inline int
+Literal_pool::integer(std::uint32_t n) const
+{
+  if (n & pooled_flag)
+    return ints_[n & ~pooled_flag];
+  return n;
+}
+
+
+// Returns the value of the string literal with index n.
+inline String const&
+Literal_pool::string(std::uint32_t n) const
+{
+  return strs_[n];
+}
+
+
+// Release the memory of the pool. The values of literal
+// tokens cannot be found afterwards.
+inline void
+Literal_pool::clear()
+{
+  std::vector<int>().swap(ints_);
+  std::vector<String>().swap(strs_);
+}
+
+
 // -------------------------------------------------------------------------- //
 //                            Token class
 
@@ -89,33 +192,46 @@ spelling(Token_kind k);
 // an integer value. This allows client languages
 // to define their own token enumeration wihtout
 // having to instantiate a new token class.
+//
+// A token is 8 bytes: the offset of its first character
+// (see Location), its kind, and a 24-bit index. The index
+// of a literal token holds or refers to its value (see
+// Literal_pool), and that of any other token refers to its
+// symbol in the symbol table. The symbol or value is found
+// by giving the table or the pool to the accessors.
 class Token
 {
 public:
   Token();
   Token(Location, int);
   Token(Location, int, Symbol const*);
+  Token(Location, int, std::uint32_t);
 
   explicit operator bool() const;
 
   int           kind() const;
-  String const& spelling() const;
   Location      location() const;
+  std::uint32_t index() const;
 
-  Symbol const*         symbol() const;
-  Identifier_sym const* identifier_symbol() const;
-  Boolean_sym const*    boolean_symbol() const;
-  Integer_sym const*    integer_symbol() const;
-  Character_sym const*  character_symbol() const;
-  String_sym const*     string_symbol() const;
+  bool                  is_literal() const;
+  String                spelling(Symbol_table_ref, Literal_pool const&) const;
+  Symbol const*         symbol(Symbol_table_ref) const;
+  Identifier_sym const* identifier_symbol(Symbol_table_ref) const;
+  Boolean_sym const*    boolean_symbol(Symbol_table_ref) const;
+  int                   integer_value(Literal_pool const&) const;
+  int                   character_value() const;
+  String const&         string_value(Literal_pool const&) const;
 
 private:
-  Location      loc_;
-  int           kind_;
-  Symbol const* sym_;
+  std::uint32_t loc_;      // The offset of the token
+  std::int32_t  kind_ : 8; // The token kind
+  std::uint32_t sym_ : 24; // The index of the symbol or literal
 };
 
 
+static_assert(sizeof(Token) == 8, "tokens must be 8 bytes");
+
+
 // Initialize the token to the error token.
 inline
 Token::Token()
@@ -134,7 +250,15 @@ Token::Token(Location loc, int k)
 // symbol table entry.
 inline
 Token::Token(Location loc, int k, Symbol const* s)
-  : loc_(loc), kind_(k), sym_(s)
+  : loc_(loc.offset()), kind_(k), sym_(s ? s->index() : 0)
+{ }
+
+
+// Initialize a literal token of kind k whose value is
+// given by the index n.
+inline
+Token::Token(Location loc, int k, std::uint32_t n)
+  : loc_(loc.offset()), kind_(k), sym_(n)
 { }
 
 
@@ -155,84 +279,96 @@ Token::kind() const
 }
 
 
-// Returns the spelling of the token.
-inline String const&
-Token::spelling() const
+// Returns the source location of the token.
+inline Location
+Token::location() const
 {
-  return sym_->spelling();
+  return Location(loc_);
 }
 
 
-// Returns the source location of the token.
-inline Location
-Token::location() const
+// Returns the index of the token's symbol or literal.
+// The index of a token with no symbol is 0.
+inline std::uint32_t
+Token::index() const
+{
+  return sym_;
+}
+
+
+// Returns true if the token is an integer, character
+// or string literal.
+inline bool
+Token::is_literal() const
 {
-  return loc_;
+  return kind_ == integer_tok || kind_ == character_tok || kind_ == string_tok;
 }
 
 
 // Returns the token's symbol and attributes.
 inline Symbol const*
-Token::symbol() const
+Token::symbol(Symbol_table_ref syms) const
 {
-  return sym_;
+  return syms.symbol(sym_);
 }
 
 
 // Return the identifier symbol for the token.
 inline Identifier_sym const*
-Token::identifier_symbol() const
+Token::identifier_symbol(Symbol_table_ref syms) const
 {
-  return cast<Identifier_sym>(sym_);
+  return cast<Identifier_sym>(symbol(syms));
 }
 
 
 // Return the boolean symbol for the token.
 inline Boolean_sym const*
-Token::boolean_symbol() const
+Token::boolean_symbol(Symbol_table_ref syms) const
 {
-  return cast<Boolean_sym>(sym_);
+  return cast<Boolean_sym>(symbol(syms));
 }
 
 
-// Returns the integer symbol for the token.
-inline Integer_sym const*
-Token::integer_symbol() const
+// Returns the value of an integer literal token.
+inline int
+Token::integer_value(Literal_pool const& lits) const
 {
-  return cast<Integer_sym>(sym_);
+  return lits.integer(sym_);
 }
 
 
-// Return the character symbol for the token.
-inline Character_sym const*
-Token::character_symbol() const
+// Returns the value of a character literal token. The
+// index of the token is the character's encoding.
+inline int
+Token::character_value() const
 {
-  return cast<Character_sym>(sym_);
+  return char(sym_);
 }
 
 
-// Return the string symbol for the token.
-inline String_sym const*
-Token::string_symbol() const
+// Returns the value of a string literal token.
+inline String const&
+Token::string_value(Literal_pool const& lits) const
 {
-  return cast<String_sym>(sym_);
+  return lits.string(sym_);
 }
 
 
 // -------------------------------------------------------------------------- //
-//                            Token buffer
+//                            Token source
 
+class Token_stream;
 
-// A token buffer is a finite sequence of tokens.
-//
-// Note that tokens are maintained in a linked list
-// so that modifications to the buffer don't invalidate
-// iterators.
-//
-// TODO: Define appropriate constructors, etc.
-struct Tokenbuf : std::list<Token>
+
+// A token source produces tokens on demand (e.g., the
+// lexer). Pulling from a source puts the next token
+// into the stream, and returns false if there are no
+// more tokens. A source that has failed produces no
+// more tokens.
+struct Token_source
 {
-  using std::list<Token>::list;
+  virtual bool pull(Token_stream&) = 0;
+  virtual bool failed() const = 0;
 };
 
 
@@ -241,77 +377,88 @@ struct Tokenbuf : std::list<Token>
 
 
 // A token stream provides a stream interface to a
-// token buffer.
+// sequence of tokens.
 //
-// TODO: This is currently modeling a read/write stream.
-// We probably need both a read and write stream position,
-// although the write position is always at the end.
+// Tokens are buffered in a ring whose capacity is a power
+// of 2. A stream can be filled in two ways. Tokens can be
+// put into the stream ahead of time, in which case the ring
+// grows to hold all of them. Alternatively, the stream can
+// pull tokens from a source as they are needed by peek and
+// get. In that case, the ring only holds the tokens of the
+// longest lookahead, regardless of the length of the input.
 class Token_stream
 {
 public:
-  using Position = Tokenbuf::iterator;
+  static constexpr std::size_t init_size = 4;
 
-  Token_stream();
+  Token_stream(Token_source* = nullptr);
 
-  bool eof() const;
+  bool eof();
+  bool failed() const;
 
-  Token peek() const;
-  Token peek(int) const;
+  Token peek();
+  Token peek(int);
   Token get();
   void put(Token);
+  void finish(Token);
 
-  Position position() const;
-  Location location() const;
+  Location location();
 
 private:
-  Tokenbuf buf_;
-  Position pos_;
+  bool fill(std::size_t);
+  void grow();
+
+  Token_source*      src_;   // The source of tokens, if any
+  std::vector<Token> buf_;   // The ring
+  std::size_t        first_; // The position of the current token
+  std::size_t        size_;  // The number of tokens in the ring
+  Token              eof_;   // The token past the end
 };
 
 
-// Initialize a token stream with an empty
-// buffer.
+// Initialize a token stream. If src is given, tokens
+// are pulled from it as needed.
 inline
-Token_stream::Token_stream()
-  : buf_(), pos_(buf_.begin())
-{ }
+Token_stream::Token_stream(Token_source* src)
+  : src_(src), buf_(init_size), first_(0), size_(0)
+{
+  memory_report().allocate<Token>(init_size);
+}
 
 
 // Returns true if the stream is at the end of the file.
 inline bool
-Token_stream::eof() const
+Token_stream::eof()
 {
-  return pos_ == buf_.end();
+  return !fill(1);
+}
+
+
+// Returns true if the source of the stream has failed.
+inline bool
+Token_stream::failed() const
+{
+  return src_ && src_->failed();
 }
 
 
 // Returns the current token.
 inline Token
-Token_stream::peek() const
+Token_stream::peek()
 {
-  if (eof())
-    return Token();
-  else
-    return *pos_;
+  return peek(0);
 }
 
 
 // Returns the nth token past the current position.
+// Note that this will gracefully handle an eof during
+// lookahead.
 inline Token
-Token_stream::peek(int n) const
+Token_stream::peek(int n)
 {
-  // Get the nth token, but restore the stream position
-  // afterwards. Note that this will gracefully handle
-  // an eof during lookahead.
-  Position i = pos_;
-  while (i != buf_.end() && n) {
-    ++i;
-    --n;
-  }
-  if (i == buf_.end())
-    return Token();
-  else
-    return *i;
+  if (!fill(n + 1))
+    return eof_;
+  return buf_[(first_ + n) & (buf_.size() - 1)];
 }
 
 
@@ -320,9 +467,11 @@ inline Token
 Token_stream::get()
 {
   if (eof())
-    return Token();
-  else
-    return *pos_++;
+    return eof_;
+  Token tok = buf_[first_];
+  first_ = (first_ + 1) & (buf_.size() - 1);
+  --size_;
+  return tok;
 }
 
 
@@ -330,36 +479,43 @@ Token_stream::get()
 inline void
 Token_stream::put(Token tok)
 {
-  buf_.push_back(tok);
+  if (size_ == buf_.size())
+    grow();
+  buf_[(first_ + size_) & (buf_.size() - 1)] = tok;
+  ++size_;
+}
+
 
-  // Make sure that the pos_ isn't pointing past
-  // then end after insertion into an empty list.
-  if (pos_ == buf_.end())
-    pos_ = buf_.begin();
+// Set the token past the end of the stream. It is an
+// invalid token whose location is the end of the input,
+// so that errors at the end can be diagnosed there.
+inline void
+Token_stream::finish(Token tok)
+{
+  eof_ = tok;
 }
 
 
-// Returns the current position of the stream. This
-// effectively an iterator into the buffer.
-inline Token_stream::Position
-Token_stream::position() const
+// Ensure that at least n tokens are buffered, pulling
+// them from the source if needed. Returns false if
+// there are fewer than n tokens left in the stream.
+inline bool
+Token_stream::fill(std::size_t n)
 {
-  return pos_;
+  while (size_ < n) {
+    if (!src_ || !src_->pull(*this))
+      return false;
+  }
+  return true;
 }
 
 
 // Returns the source location of the current token.
 inline Location
-Token_stream::location() const
+Token_stream::location()
 {
   return peek().location();
 }
 
 
-// -------------------------------------------------------------------------- //
-// Symbol initialization
-
-void init_symbols(Symbol_table&);
-
-
 #endif
@@ -0,0 +1,125 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#include "trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+namespace
+{
+
+// Returns the current time in microseconds.
+inline double
+clock_us()
+{
+  using Clock = std::chrono::steady_clock;
+  std::chrono::duration<double, std::micro> d = Clock::now().time_since_epoch();
+  return d.count();
+}
+
+
+// Write s as a JSON string.
+void
+write_string(std::ostream& os, String const& s)
+{
+  os << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      os << ' ';
+    else
+      os << c;
+  }
+  os << '"';
+}
+
+} // namespace
+
+
+Trace_log::Trace_log()
+  : on_(false), origin_(clock_us())
+{ }
+
+
+// Enable tracing. Events are written to the file at
+// path when the log is written.
+void
+Trace_log::enable(char const* path)
+{
+  on_ = true;
+  path_ = path;
+  origin_ = clock_us();
+}
+
+
+// Returns the time since tracing was enabled.
+double
+Trace_log::now() const
+{
+  return clock_us() - origin_;
+}
+
+
+// Record a span in the category c with name n, starting
+// at time t and lasting for d microseconds.
+void
+Trace_log::add(char const* c, char const* n, double t, double d)
+{
+  int tid = trace_thread_id();
+  std::lock_guard<std::mutex> lock(mtx_);
+  events_.push_back({n, c, t, d, tid});
+}
+
+
+// Write the trace events in the Chrome trace_event
+// JSON format. Returns false if the file could not
+// be written.
+bool
+Trace_log::write() const
+{
+  std::ofstream os(path_);
+  if (!os) {
+    std::cerr << "error: cannot open trace file '" << path_ << "'\n";
+    return false;
+  }
+
+  os << std::fixed << std::setprecision(3);
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+     << "\"args\":{\"name\":\"beaker\"}}";
+  for (Trace_event const& e : events_) {
+    os << ",\n{\"name\":";
+    write_string(os, e.name);
+    os << ",\"cat\":\"" << e.cat << "\",\"ph\":\"X\""
+       << ",\"ts\":" << e.ts << ",\"dur\":" << e.dur
+       << ",\"pid\":1,\"tid\":" << e.tid << '}';
+  }
+  os << "\n]}\n";
+  return bool(os);
+}
+
+
+// Returns the global trace log.
+Trace_log&
+trace_log()
+{
+  static Trace_log log;
+  return log;
+}
+
+
+// Returns a small integer identifying the current thread.
+// Each thread appears as a separate track in the trace.
+int
+trace_thread_id()
+{
+  static std::atomic<int> next(0);
+  thread_local int id = next++;
+  return id;
+}
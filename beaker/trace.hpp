@@ -0,0 +1,99 @@
+// Copyright (c) 2015 Andrew Sutton
+// All rights reserved
+
+#ifndef BEAKER_TRACE_HPP
+#define BEAKER_TRACE_HPP
+
+// The trace module supports the -ftrace option. It records
+// spans of time as Chrome trace events, which can be viewed
+// in chrome://tracing or Perfetto.
+//
+// Each span is recorded on the track of the thread that
+// created it. Tracing is disabled by default. When disabled,
+// a span costs one test of a flag.
+
+#include "string.hpp"
+
+#include <mutex>
+#include <vector>
+
+
+// A completed span.
+struct Trace_event
+{
+  String      name;
+  char const* cat;
+  double      ts;   // Start time, in microseconds
+  double      dur;  // Duration, in microseconds
+  int         tid;  // Track (thread) id
+};
+
+
+// The trace log accumulates events and writes them to
+// a file when closed. Events may be added concurrently.
+class Trace_log
+{
+public:
+  Trace_log();
+
+  bool enabled() const { return on_; }
+  void enable(char const*);
+
+  double now() const;
+  void   add(char const*, char const*, double, double);
+
+  bool write() const;
+
+private:
+  bool        on_;
+  String      path_;
+  double      origin_;
+  std::mutex  mtx_;
+  std::vector<Trace_event> events_;
+};
+
+
+Trace_log& trace_log();
+
+int trace_thread_id();
+
+
+// An RAII class that records a span over its lifetime, or
+// until it is stopped. Note that the name is copied only
+// when the span is recorded, so it must outlive the span.
+class Trace_span
+{
+public:
+  Trace_span(char const*, char const*);
+  ~Trace_span() { stop(); }
+
+  void stop();
+
+private:
+  char const* cat_;
+  char const* name_;
+  bool        on_;
+  double      start_;
+};
+
+
+inline
+Trace_span::Trace_span(char const* c, char const* n)
+  : cat_(c), name_(n), on_(trace_log().enabled())
+{
+  if (on_)
+    start_ = trace_log().now();
+}
+
+
+inline void
+Trace_span::stop()
+{
+  if (on_) {
+    trace_log().add(cat_, name_, start_, trace_log().now() - start_);
+    on_ = false;
+  }
+}
+
+
+#endif
@@ -6,6 +6,8 @@
 #include "less.hpp"
 #include "value.hpp"
 #include "evaluator.hpp"
+#include "timer.hpp"
+#include "make.hpp"
 
 #include <set>
 
@@ -74,13 +76,33 @@ template<typename T>
 using Type_set = std::set<T, Type_less<T>>;
 
 
+Counter interning_hits("types.hits", "canonical types found");
+Counter interning_misses("types.misses", "canonical types created");
+
+
+// Record the result of an insertion into a type set, and
+// return the canonical type.
+template<typename T>
+inline Type const*
+interned(std::pair<typename Type_set<T>::iterator, bool> ins)
+{
+  if (ins.second) {
+    ++interning_misses;
+    memory_report().allocate<T>();
+  }
+  else
+    ++interning_hits;
+  return &*ins.first;
+}
+
+
 // Note that id types are not canonicalized.
 // They don't need to be since they never
 // escape elaboration.
 Type const*
 get_id_type(Symbol const* s)
 {
-  return new Id_type(s);
+  return make<Id_type>(s);
 }
 
 
@@ -111,9 +133,10 @@ get_integer_type()
 Type const*
 get_function_type(Type_seq const& t, Type const* r)
 {
+  Timer_sentinel timer(interning_time);
   static Type_set<Function_type> fn;
   auto ins = fn.emplace(t, r);
-  return &*ins.first;
+  return interned<Function_type>(ins);
 }
 
 
@@ -131,18 +154,20 @@ get_function_type(Decl_seq const& d, Type const* r)
 Type const*
 get_array_type(Type const* t, Expr* n)
 {
+  Timer_sentinel timer(interning_time);
   static Type_set<Array_type> ts;
   auto ins = ts.emplace(t, n);
-  return &*ins.first;
+  return interned<Array_type>(ins);
 }
 
 
 Type const*
 get_block_type(Type const* t)
 {
+  Timer_sentinel timer(interning_time);
   static Type_set<Block_type> ts;
   auto ins = ts.emplace(t);
-  return &*ins.first;
+  return interned<Block_type>(ins);
 }
 
 
@@ -150,16 +175,18 @@ get_block_type(Type const* t)
 Type const*
 get_reference_type(Type const* t)
 {
+  Timer_sentinel timer(interning_time);
   static Type_set<Reference_type> ts;
   auto ins = ts.emplace(t);
-  return &*ins.first;
+  return interned<Reference_type>(ins);
 }
 
 
 Type const*
 get_record_type(Record_decl* r)
 {
+  Timer_sentinel timer(interning_time);
   static Type_set<Record_type> ts;
   auto ins = ts.emplace(r);
-  return &*ins.first;
+  return interned<Record_type>(ins);
 }
@@ -7,6 +7,9 @@
 #include <iostream>
 
 
+Counter allocated_values("values.allocated", "values allocated for aggregates");
+
+
 // Return a string value for the arary. This is
 // needed for any transformation to narrow string 
 // literals in the evaluation character set.
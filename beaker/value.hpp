@@ -10,6 +10,8 @@
 // TODO: Make a visitor for values.
 
 #include "prelude.hpp"
+#include "stats.hpp"
+#include "memory.hpp"
 
 
 struct Value;
@@ -358,10 +360,16 @@ apply(Value& v, F fn)
 // -------------------------------------------------------------------------- //
 // Aggregate values
 
+extern Counter allocated_values;
+
+
 inline
 Aggregate_value::Aggregate_value(std::size_t n)
   : len(n), data(new Value[n])
-{ }
+{
+  allocated_values += n;
+  memory_report().allocate<Value>(n);
+}
 
 
 inline